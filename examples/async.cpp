@@ -0,0 +1,175 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+/*
+ * Coroutine sequences: band change with settled signal, ATU tune, PTT with confirmed TX.
+ * A monitor task runs alongside on the same thread.
+ *
+ *   x6200_async [-f freq] [-p ptt ms]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+
+#include <aether_radio/x6200_control/async.hpp>
+
+#define SETTLE_DB       1
+#define SETTLE_PACKETS  3
+#define SETTLE_MAX      30
+
+static bool done = false;
+static bool result = false;
+
+static double now_ms() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static x6200::task<bool> band_change(uint32_t freq) {
+    double start = now_ms();
+
+    x6200::vfo_freq_set(x6200::vfo::a, freq);
+
+    auto pack = co_await x6200::command_committed(500);
+
+    if (!pack) {
+        co_return false;
+    }
+
+    int16_t prev = pack->dbm;
+    int     run = 0;
+
+    for (int i = 0; i < SETTLE_MAX && run < SETTLE_PACKETS; i++) {
+        x6200_flow_t next = co_await x6200::next_packet();
+
+        run = abs(next.dbm - prev) <= SETTLE_DB ? run + 1 : 0;
+        prev = next.dbm;
+    }
+
+    printf("Band %u: %s, %d dBm in %.0f ms\n", freq, run < SETTLE_PACKETS ? "not settled" : "settled",
+           prev - 127, now_ms() - start);
+
+    co_return run >= SETTLE_PACKETS;
+}
+
+static x6200::task<bool> atu_tune() {
+    double start = now_ms();
+
+    x6200_control_atu_set(true);
+    x6200_control_atu_tune(true);
+
+    auto on = co_await x6200::flag_change(x6200::flag::tx, 1000);
+    auto off = on && on->tx ? co_await x6200::flag_change(x6200::flag::tx, 10000) : std::nullopt;
+
+    x6200_control_atu_tune(false);
+
+    if (!off) {
+        printf("ATU: no %s\n", on ? "TX fall" : "TX");
+        co_return false;
+    }
+
+    x6200_flow_t pack = co_await x6200::next_packet();
+
+    printf("ATU: tuned %08X in %.0f ms\n", pack.atu_params, now_ms() - start);
+    co_return true;
+}
+
+static x6200::task<bool> ptt_check(uint32_t ms) {
+    double start = now_ms();
+
+    x6200_control_ptt_set(true);
+
+    auto on = co_await x6200::flag_change(x6200::flag::tx, 500);
+
+    if (!on || !on->tx) {
+        x6200_control_ptt_set(false);
+        printf("PTT: no TX\n");
+        co_return false;
+    }
+
+    double rise = now_ms() - start;
+
+    co_await x6200::sleep(ms);
+
+    start = now_ms();
+    x6200_control_ptt_set(false);
+
+    auto off = co_await x6200::flag_change(x6200::flag::tx, 500);
+
+    printf("PTT: TX on in %.0f ms, off in %.0f ms\n", rise, now_ms() - start);
+    co_return off && !off->tx;
+}
+
+static x6200::task<> sequence(uint32_t freq, uint32_t ptt_ms) {
+    co_await x6200::next_packet();      /* BASE is streaming */
+
+    bool ok = co_await band_change(freq) && co_await atu_tune() && co_await ptt_check(ptt_ms);
+
+    printf("Sequence %s\n", ok ? "done" : "failed");
+    result = ok;
+    done = true;
+}
+
+static x6200::task<> monitor() {
+    while (!done) {
+        auto pack = co_await x6200::next_packet(1000);
+
+        if (!pack) {
+            printf("Monitor: no packets\n");
+        } else {
+            printf("Monitor: tx=%d vext=%.1f\n", pack->flag.tx, pack->vext * 0.1f);
+        }
+        co_await x6200::sleep(500);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t    freq = 14074000;
+    uint32_t    ptt_ms = 300;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "f:p:")) != -1) {
+        switch (opt) {
+            case 'f':
+                freq = atoi(optarg);
+                break;
+
+            case 'p':
+                ptt_ms = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-f freq] [-p ptt ms]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    x6200::control  control;
+    x6200::flow     flow;
+
+    if (!control || !flow) {
+        return 1;
+    }
+
+    x6200::executor ex(2000);
+
+    if (!ex) {
+        return 1;
+    }
+
+    ex.spawn(sequence(freq, ptt_ms));
+    ex.spawn(monitor());
+    ex.run();
+
+    return result ? 0 : 1;
+}
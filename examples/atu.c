@@ -7,24 +7,49 @@
  *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
  */
 
+/*
+ * ATU tune with memory. First run on a frequency makes a tune cycle, next runs in the same
+ * segment restore the stored network without carrier.
+ *
+ *   x6200_atu [-f freq] [-m memory file] [-F]
+ */
+
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 
+#include <aether_radio/x6200_control/atu.h>
 #include <aether_radio/x6200_control/control.h>
 #include <aether_radio/x6200_control/low/flow.h>
 #include <aether_radio/x6200_control/low/gpio.h>
 
-typedef enum {
-    ATU_IDLE = 0,
-    ATU_START,
-    ATU_RUN,
-    ATU_DONE
-} atu_status_t;
-
 static x6200_flow_t pack;
 
-int main() {
-    atu_status_t atu = ATU_IDLE;
+int main(int argc, char *argv[]) {
+    x6200_atu_config_t  conf = { .path = "/tmp/x6200_atu" };
+    uint32_t            freq = 7135000;
+    bool                force = false;
+    int                 opt;
+
+    while ((opt = getopt(argc, argv, "f:m:F")) != -1) {
+        switch (opt) {
+            case 'f':
+                freq = atoi(optarg);
+                break;
+
+            case 'm':
+                conf.path = optarg;
+                break;
+
+            case 'F':
+                force = true;
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-f freq] [-m memory file] [-F]\n", argv[0]);
+                return 1;
+        }
+    }
 
     if (!x6200_control_init())
         return 1;
@@ -35,42 +60,60 @@ int main() {
     if (!x6200_gpio_init())
         return 1;
 
-    x6200_control_vfo_freq_set(X6200_VFO_A, 7135000);
+    if (!x6200_atu_init(&conf))
+        return 1;
+
+    x6200_control_vfo_freq_set(X6200_VFO_A, freq);
+    x6200_control_atu_set(true);
+
+    /* Tune when BASE is streaming */
 
-    while (atu != ATU_DONE) {
-        if (!x6200_flow_read(&pack)) {
-            usleep(25000);
-            continue;
+    while (!x6200_flow_read(&pack)) {
+        usleep(25000);
+    }
+
+    x6200_atu_result_t res = x6200_atu_start(force);
+
+    if (res == X6200_ATU_STARTED) {
+        x6200_gpio_set(x6200_pin_light, 1);
+
+        while (x6200_atu_state() != X6200_ATU_IDLE) {
+            if (!x6200_flow_read(&pack)) {
+                usleep(25000);
+                continue;
+            }
+
+            printf("tx=%d "
+                   "txpwr=%.1f swr=%.1f alc=%.1f vext=%.1f vbat=%.1f bat=%d atu_params=%08X\n",
+                   pack.flag.tx, pack.tx_power * 0.1, pack.vswr * 0.1f, pack.alc_level * 0.1,
+                   pack.vext * 0.1f, pack.vbat * 0.1f, pack.batcap, pack.atu_params);
+
+            x6200_atu_process(&pack);
         }
+        x6200_gpio_set(x6200_pin_light, 0);
+        res = x6200_atu_result();
+    }
+
+    x6200_atu_stats_t   stats;
+    uint32_t            params = 0;
 
-        printf("tx=%d "
-               "txpwr=%.1f swr=%.1f alc=%.1f vext=%.1f vbat=%.1f bat=%d atu_params=%08X\n",
-               pack.flag.tx, pack.tx_power * 0.1, pack.vswr * 0.1f, pack.alc_level * 0.1,
-               pack.vext * 0.1f, pack.vbat * 0.1f, pack.batcap, pack.atu_params);
-
-        switch (atu)
-        {
-        case ATU_IDLE:
-            x6200_control_atu_tune(true);
-            x6200_gpio_set(x6200_pin_light, 1);
-            atu = ATU_START;
+    x6200_atu_stats(&stats);
+    x6200_atu_lookup(freq, &params);
+
+    switch (res) {
+        case X6200_ATU_RESTORED:
+            printf("Restored %08X from memory\n", params);
             break;
 
-        case ATU_START:
-            if (pack.flag.tx)
-            {
-                atu = ATU_RUN;
-            }
+        case X6200_ATU_TUNED:
+            printf("Tuned %08X in %.0f ms, %zu segments in memory\n", params, stats.last_tune_ms, stats.entries);
             break;
 
-        case ATU_RUN:
-            if (!pack.flag.tx)
-            {
-                x6200_control_atu_tune(false);
-                x6200_gpio_set(x6200_pin_light, 0);
-                atu = ATU_DONE;
-            }
+        default:
+            printf("Tune failed\n");
             break;
-        }
     }
+
+    x6200_atu_close();
+    return res == X6200_ATU_FAILED;
 }
@@ -0,0 +1,381 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+/*
+ * Control path latency benchmark. Time from setter call to completed transfer, per setter,
+ * for profile writes (one register at a time / batched / snapshot restore) and under
+ * concurrent callers. One JSON object per line, on stdout or to -o file. Library messages go
+ * to stderr, so stdout carries only JSON:
+ *
+ *   x6200_bench [-t mem|kernel|file] [-n iterations] [-j threads] [-o file]
+ *
+ * Without a radio: -t mem, or -t file with BASE simulator (examples/sim.c) serving X6200_I2C_FILE.
+ * -t kernel is for real BASE only, SMBus-only adapters (i2c-stub) can't do I2C_RDWR transfers.
+ * Setters that key TX or start a BASE process (PTT, ATU tune, power off, modem...) are skipped.
+ * Setters read-modify-write the shared register mirror, so concurrent callers are serialized
+ * with a mutex, as an application sharing the control API between threads has to do.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <aether_radio/x6200_control/control.h>
+#include <aether_radio/x6200_control/low/transport.h>
+
+typedef void (*setter_fn_t)(uint32_t i);
+
+typedef struct {
+    const char  *name;
+    setter_fn_t fn;
+} setter_t;
+
+typedef struct {
+    uint32_t    iterations;
+    uint32_t    seed;
+    float       *samples;
+} worker_t;
+
+static const char   *transport = "mem";
+static uint32_t     iterations = 2000;
+static uint32_t     threads = 4;
+static FILE         *out;
+
+static pthread_mutex_t  setter_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Setters */
+
+#define SETTER(name, call) static void b_##name(uint32_t i) { call; }
+
+SETTER(vfo_set,             x6200_control_vfo_set(i & 1))
+SETTER(vfo_mode_set,        x6200_control_vfo_mode_set(X6200_VFO_A, i & 1 ? x6200_mode_usb : x6200_mode_cw))
+SETTER(vfo_agc_set,         x6200_control_vfo_agc_set(X6200_VFO_A, i % 4))
+SETTER(vfo_freq_set,        x6200_control_vfo_freq_set(X6200_VFO_A, 7000000 + (i % 2) * 7000000 + i % 1000))
+SETTER(vfo_att_set,         x6200_control_vfo_att_set(X6200_VFO_A, i & 1))
+SETTER(vfo_pre_set,         x6200_control_vfo_pre_set(X6200_VFO_A, i & 1))
+SETTER(rfg_set,             x6200_control_rfg_set(i % 100))
+SETTER(txpwr_set,           x6200_control_txpwr_set((i % 100) * 0.1f))
+SETTER(sql_set,             x6200_control_sql_set(i % 100))
+SETTER(sql_fm_set,          x6200_control_sql_fm_set(i % 100))
+SETTER(sql_enable_set,      x6200_control_sql_enable_set(i & 1))
+SETTER(monitor_level_set,   x6200_control_monitor_level_set(i % 100))
+SETTER(fft_dec_set,         x6200_control_fft_dec_set(i % 5))
+SETTER(fft_zoom_cw_set,     x6200_control_fft_zoom_cw_set(i % 5))
+SETTER(rxvol_set,           x6200_control_rxvol_set(i % 50))
+SETTER(record_set,          x6200_control_record_set(i & 1))
+SETTER(spmode_set,          x6200_control_spmode_set(i & 1))
+SETTER(rx_filter_set,       x6200_control_rx_filter_set(50 + i % 100, 2700 + i % 100))
+SETTER(rx_filter_set_low,   x6200_control_rx_filter_set_low(50 + i % 100))
+SETTER(rx_filter_set_high,  x6200_control_rx_filter_set_high(2700 + i % 100))
+SETTER(filter_bank_set,     x6200_control_filter_bank_set(X6200_FILTER_CW, 200 + i % 100, 800))
+SETTER(split_set,           x6200_control_split_set(i & 1))
+SETTER(atu_set,             x6200_control_atu_set(i & 1))
+SETTER(key_speed_set,       x6200_control_key_speed_set(10 + i % 30))
+SETTER(key_mode_set,        x6200_control_key_mode_set(i % 3))
+SETTER(iambic_mode_set,     x6200_control_iambic_mode_set(i & 1))
+SETTER(key_tone_set,        x6200_control_key_tone_set(500 + i % 300))
+SETTER(key_vol_set,         x6200_control_key_vol_set(i % 30))
+SETTER(key_train_set,       x6200_control_key_train_set(i & 1))
+SETTER(qsk_time_set,        x6200_control_qsk_time_set(i % 1000))
+SETTER(key_ratio_set,       x6200_control_key_ratio_set(2.5f + (i % 20) * 0.1f))
+SETTER(linein_set,          x6200_control_linein_set(i % 36))
+SETTER(lineout_set,         x6200_control_lineout_set(i % 36))
+SETTER(iqout_set,           x6200_control_iqout_set(i & 1))
+SETTER(imic_set,            x6200_control_imic_set(i % 36))
+SETTER(hmic_set,            x6200_control_hmic_set(i % 36))
+SETTER(mic_set,             x6200_control_mic_set(i % 3))
+SETTER(dnf_set,             x6200_control_dnf_set(i & 1))
+SETTER(dnf_center_set,      x6200_control_dnf_center_set(1000 + i % 1000))
+SETTER(dnf_width_set,       x6200_control_dnf_width_set(50 + i % 100))
+SETTER(nb_set,              x6200_control_nb_set(i & 1))
+SETTER(nb_level_set,        x6200_control_nb_level_set(i % 100))
+SETTER(nb_width_set,        x6200_control_nb_width_set(i % 100))
+SETTER(nr_set,              x6200_control_nr_set(i & 1))
+SETTER(nr_level_set,        x6200_control_nr_level_set(i % 60))
+SETTER(agc_hang_set,        x6200_control_agc_hang_set(i & 1))
+SETTER(agc_knee_set,        x6200_control_agc_knee_set(-(int8_t)(i % 100)))
+SETTER(agc_slope_set,       x6200_control_agc_slope_set(i % 10))
+SETTER(agc_time_set,        x6200_control_agc_time_set(100 + i % 1000))
+SETTER(vox_set,             x6200_control_vox_set(i & 1))
+SETTER(vox_ag_set,          x6200_control_vox_ag_set(i % 100))
+SETTER(vox_delay_set,       x6200_control_vox_delay_set(100 + i % 1900))
+SETTER(vox_gain_set,        x6200_control_vox_gain_set(i % 100))
+SETTER(rit_set,             x6200_control_rit_set(i % 200 - 100))
+SETTER(xit_set,             x6200_control_xit_set(i % 200 - 100))
+SETTER(comp_set,            x6200_control_comp_set(i & 1))
+SETTER(comp_level_set,      x6200_control_comp_level_set(i % 5))
+SETTER(rx_eq_set,           x6200_control_rx_eq_set(i & 1))
+SETTER(rx_eq_p1_set,        x6200_control_rx_eq_p1_set(i % 20 - 10))
+SETTER(rx_eq_apply,         x6200_control_rx_eq_apply(true, (const int8_t[5]) { i % 20 - 10, 1, 2, 3, 4 }))
+SETTER(rx_eq_wfm_set,       x6200_control_rx_eq_wfm_set(i & 1))
+SETTER(rx_eq_wfm_p1_set,    x6200_control_rx_eq_wfm_p1_set(i % 20 - 10))
+SETTER(mic_eq_set,          x6200_control_mic_eq_set(i & 1))
+SETTER(mic_eq_p1_set,       x6200_control_mic_eq_p1_set(i % 20 - 10))
+
+#define ENTRY(name) { #name, b_##name }
+
+static const setter_t setters[] = {
+    ENTRY(vfo_set), ENTRY(vfo_mode_set), ENTRY(vfo_agc_set), ENTRY(vfo_freq_set),
+    ENTRY(vfo_att_set), ENTRY(vfo_pre_set), ENTRY(rfg_set), ENTRY(txpwr_set),
+    ENTRY(sql_set), ENTRY(sql_fm_set), ENTRY(sql_enable_set), ENTRY(monitor_level_set),
+    ENTRY(fft_dec_set), ENTRY(fft_zoom_cw_set), ENTRY(rxvol_set), ENTRY(record_set),
+    ENTRY(spmode_set), ENTRY(rx_filter_set), ENTRY(rx_filter_set_low), ENTRY(rx_filter_set_high),
+    ENTRY(filter_bank_set), ENTRY(split_set), ENTRY(atu_set), ENTRY(key_speed_set),
+    ENTRY(key_mode_set), ENTRY(iambic_mode_set), ENTRY(key_tone_set), ENTRY(key_vol_set),
+    ENTRY(key_train_set), ENTRY(qsk_time_set), ENTRY(key_ratio_set), ENTRY(linein_set),
+    ENTRY(lineout_set), ENTRY(iqout_set), ENTRY(imic_set), ENTRY(hmic_set),
+    ENTRY(mic_set), ENTRY(dnf_set), ENTRY(dnf_center_set), ENTRY(dnf_width_set),
+    ENTRY(nb_set), ENTRY(nb_level_set), ENTRY(nb_width_set), ENTRY(nr_set),
+    ENTRY(nr_level_set), ENTRY(agc_hang_set), ENTRY(agc_knee_set), ENTRY(agc_slope_set),
+    ENTRY(agc_time_set), ENTRY(vox_set), ENTRY(vox_ag_set), ENTRY(vox_delay_set),
+    ENTRY(vox_gain_set), ENTRY(rit_set), ENTRY(xit_set), ENTRY(comp_set),
+    ENTRY(comp_level_set), ENTRY(rx_eq_set), ENTRY(rx_eq_p1_set), ENTRY(rx_eq_apply),
+    ENTRY(rx_eq_wfm_set), ENTRY(rx_eq_wfm_p1_set), ENTRY(mic_eq_set), ENTRY(mic_eq_p1_set),
+};
+
+#define SETTERS_COUNT (sizeof(setters) / sizeof(setters[0]))
+
+/* Profile: typical band change with filters, AGC and DSP */
+
+static const x6200_cmd_enum_t profile_regs[] = {
+    x6200_vfoa_ham_band, x6200_vfoa_freq, x6200_vfoa_att, x6200_vfoa_pre, x6200_vfoa_mode,
+    x6200_vfoa_agc, x6200_rxvol, x6200_rfg_txpwr, x6200_nrthr_nbw_nbthr_nre_nbe,
+    x6200_dnfcnt_dnfwidth_dnfe, x6200_agcknee_agcslope_agchang, x6200_agctime, x6200_rxfilter,
+};
+
+#define PROFILE_COUNT (sizeof(profile_regs) / sizeof(profile_regs[0]))
+
+static double now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static int cmp_float(const void *a, const void *b)
+{
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+
+    return (x > y) - (x < y);
+}
+
+static float percentile(const float *sorted, size_t count, double p)
+{
+    size_t index = (size_t)(p * (count - 1) + 0.5);
+
+    return sorted[index];
+}
+
+static void report(const char *group, const char *name, float *samples, size_t count,
+                   uint32_t nthreads, double wall_us)
+{
+    double sum = 0.0;
+
+    qsort(samples, count, sizeof(float), cmp_float);
+
+    for (size_t i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+
+    fprintf(out, "{\"transport\":\"%s\",\"group\":\"%s\",\"name\":\"%s\",\"threads\":%u,\"count\":%zu,"
+           "\"mean_us\":%.3f,\"p50_us\":%.3f,\"p99_us\":%.3f,\"p999_us\":%.3f,\"max_us\":%.3f,"
+           "\"ops_per_sec\":%.1f}\n",
+           transport, group, name, nthreads, count,
+           sum / count, percentile(samples, count, 0.5), percentile(samples, count, 0.99),
+           percentile(samples, count, 0.999), samples[count - 1],
+           wall_us > 0.0 ? count * 1000000.0 / wall_us : 0.0);
+}
+
+static void bench_setters(float *samples)
+{
+    for (size_t n = 0; n < SETTERS_COUNT; n++) {
+        double start = now_us();
+
+        for (uint32_t i = 0; i < iterations; i++) {
+            double t = now_us();
+
+            setters[n].fn(i);
+            samples[i] = now_us() - t;
+        }
+        report("setter", setters[n].name, samples, iterations, 1, now_us() - start);
+    }
+}
+
+static void bench_profile(float *samples)
+{
+    x6200_cmd_arg_t     cmds[PROFILE_COUNT];
+    x6200_snapshot_t    snap[2];
+    double              start;
+
+    for (size_t r = 0; r < PROFILE_COUNT; r++) {
+        cmds[r].cmd = profile_regs[r];
+    }
+
+    /* One register at a time */
+
+    start = now_us();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        double t = now_us();
+
+        for (size_t r = 0; r < PROFILE_COUNT; r++) {
+            x6200_control_cmd(profile_regs[r], x6200_control_get(profile_regs[r]) ^ (i & 1));
+        }
+        samples[i] = now_us() - t;
+    }
+    report("profile", "unbatched", samples, iterations, 1, now_us() - start);
+
+    /* Batched */
+
+    start = now_us();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        double t = now_us();
+
+        for (size_t r = 0; r < PROFILE_COUNT; r++) {
+            cmds[r].arg = x6200_control_get(profile_regs[r]) ^ (i & 1);
+        }
+        x6200_control_cmd_batch(cmds, PROFILE_COUNT);
+        samples[i] = now_us() - t;
+    }
+    report("profile", "batched", samples, iterations, 1, now_us() - start);
+
+    /* Snapshot restore, only differing registers */
+
+    x6200_control_snapshot(&snap[0]);
+    x6200_control_vfo_freq_set(X6200_VFO_A, 14074000);
+    x6200_control_vfo_mode_set(X6200_VFO_A, x6200_mode_usb_dig);
+    x6200_control_rx_filter_set(100, 3000);
+    x6200_control_snapshot(&snap[1]);
+
+    start = now_us();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        double t = now_us();
+
+        x6200_control_restore(&snap[i & 1]);
+        samples[i] = now_us() - t;
+    }
+    report("profile", "restore", samples, iterations, 1, now_us() - start);
+}
+
+static void *worker(void *arg)
+{
+    worker_t *w = arg;
+
+    for (uint32_t i = 0; i < w->iterations; i++) {
+        w->seed = w->seed * 1103515245 + 12345;
+
+        const setter_t  *s = &setters[(w->seed >> 16) % SETTERS_COUNT];
+        double          t = now_us();
+
+        pthread_mutex_lock(&setter_mutex);
+        s->fn(i);
+        pthread_mutex_unlock(&setter_mutex);
+        w->samples[i] = now_us() - t;
+    }
+    return NULL;
+}
+
+static void bench_concurrent(float *samples)
+{
+    for (uint32_t nthreads = 1; nthreads <= threads; nthreads *= 2) {
+        pthread_t   tid[nthreads];
+        worker_t    w[nthreads];
+        char        name[32];
+        double      start = now_us();
+
+        for (uint32_t n = 0; n < nthreads; n++) {
+            w[n].iterations = iterations;
+            w[n].seed = n + 1;
+            w[n].samples = samples + n * iterations;
+            pthread_create(&tid[n], NULL, worker, &w[n]);
+        }
+        for (uint32_t n = 0; n < nthreads; n++) {
+            pthread_join(tid[n], NULL);
+        }
+
+        snprintf(name, sizeof(name), "mixed_x%u", nthreads);
+        report("concurrent", name, samples, nthreads * iterations, nthreads, now_us() - start);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+
+    out = NULL;
+
+    while ((opt = getopt(argc, argv, "t:n:j:o:")) != -1) {
+        switch (opt) {
+            case 't':
+                transport = optarg;
+                break;
+
+            case 'n':
+                iterations = atoi(optarg);
+                break;
+
+            case 'j':
+                threads = atoi(optarg);
+                break;
+
+            case 'o':
+                out = fopen(optarg, "w");
+
+                if (!out) {
+                    perror("Can't open output");
+                    return 1;
+                }
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-t mem|kernel|file] [-n iterations] [-j threads] [-o file]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (iterations == 0 || threads == 0 || !x6200_transport_select(transport)) {
+        fprintf(stderr, "Wrong arguments\n");
+        return 1;
+    }
+
+    /* Keep stdout for JSON, everything else printed to it goes to stderr */
+
+    if (!out) {
+        out = fdopen(dup(STDOUT_FILENO), "w");
+
+        if (!out) {
+            perror("Can't open output");
+            return 1;
+        }
+    }
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    if (!x6200_control_init())
+        return 1;
+
+    float *samples = malloc(sizeof(float) * iterations * threads);
+
+    if (!samples)
+        return 1;
+
+    bench_setters(samples);
+    bench_profile(samples);
+    bench_concurrent(samples);
+
+    free(samples);
+    fclose(out);
+    return 0;
+}
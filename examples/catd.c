@@ -0,0 +1,942 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+/*
+ * CAT daemon. Hamlib rigctld network protocol on TCP (and optional Unix socket), Kenwood TS-2000
+ * subset on a second TCP port. Works on the event loop, one thread.
+ *
+ * Queries are answered from the register mirror and the last flow packet, without bus access.
+ * Writes are not sent at once: they are kept as pending state for coalesce time, then applied
+ * together. A logger sweeping the frequency makes one write per coalesce time, and a query
+ * after a set sees the pending value.
+ *
+ *   x6200_catd -p 4532 -k 4533 -u /tmp/x6200_cat
+ *   rigctl -m 2 -r localhost:4532 f
+ */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <aether_radio/x6200_control/control.h>
+#include <aether_radio/x6200_control/loop.h>
+#include <aether_radio/x6200_control/low/flow.h>
+
+#define MAX_CLIENTS     16
+#define IN_SIZE         1024
+#define OUT_SIZE        8192
+
+#define METER_ZERO_DBM  -127    /* pack.dbm 0 */
+#define S9_DBM          -73
+#define MAX_POWER       10.0f
+
+/* Hamlib error codes */
+
+#define RIG_OK          0
+#define RIG_EINVAL      -1
+#define RIG_ENAVAIL     -11
+
+typedef enum {
+    PROTO_RIGCTL = 0,
+    PROTO_KENWOOD,
+} proto_t;
+
+typedef struct {
+    int         fd;
+    proto_t     proto;
+    size_t      in_len;
+    size_t      out_len;
+    bool        out_wait;       /* Socket is full, waiting for EPOLLOUT */
+    char        in[IN_SIZE];
+    char        out[OUT_SIZE];
+} client_t;
+
+typedef struct {
+    int         fd;
+    proto_t     proto;
+} listener_t;
+
+static listener_t   listeners[3];
+static client_t     *clients[MAX_CLIENTS];
+
+static x6200_flow_t last_pack;
+static bool         have_pack = false;
+
+static uint32_t     coalesce_ms = 20;
+static const char   *unix_path = NULL;
+
+/* Pending writes */
+
+static struct {
+    bool            has_vfo;
+    x6200_vfo_t     vfo;
+    bool            has_freq[2];
+    uint32_t        freq[2];
+    bool            has_mode[2];
+    x6200_mode_t    mode[2];
+    int32_t         passband[2];        /* 0 - keep filter */
+    bool            has_split;
+    bool            split;
+    bool            has_ptt;
+    bool            ptt;
+    bool            has_pwr;
+    float           pwr;
+
+    bool            scheduled;
+} pending;
+
+static struct {
+    uint64_t        commands;
+    uint64_t        sets;
+    uint64_t        flushes;
+} stats;
+
+/* Modes */
+
+static const struct {
+    const char      *hamlib;
+    uint8_t         kenwood;
+    x6200_mode_t    mode;
+} modes[] = {
+    { "LSB",    1, x6200_mode_lsb },
+    { "USB",    2, x6200_mode_usb },
+    { "CW",     3, x6200_mode_cw },
+    { "FM",     4, x6200_mode_nfm },
+    { "AM",     5, x6200_mode_am },
+    { "PKTLSB", 6, x6200_mode_lsb_dig },
+    { "CWR",    7, x6200_mode_cwr },
+    { "PKTUSB", 9, x6200_mode_usb_dig },
+    { "AMS",    0, x6200_mode_sam },
+    { "WFM",    0, x6200_mode_wfm },
+};
+
+#define MODES_COUNT (sizeof(modes) / sizeof(modes[0]))
+
+/* Cached state, pending writes first */
+
+static x6200_vfo_t state_vfo()
+{
+    if (pending.has_vfo) {
+        return pending.vfo;
+    }
+    return (x6200_control_get(x6200_vi_vm) & 0xFF) ? X6200_VFO_B : X6200_VFO_A;
+}
+
+static uint32_t state_freq(x6200_vfo_t vfo)
+{
+    if (pending.has_freq[vfo]) {
+        return pending.freq[vfo];
+    }
+    return x6200_control_get(vfo == X6200_VFO_A ? x6200_vfoa_freq : x6200_vfob_freq);
+}
+
+static x6200_mode_t state_mode(x6200_vfo_t vfo)
+{
+    if (pending.has_mode[vfo]) {
+        return pending.mode[vfo];
+    }
+    return x6200_control_get(vfo == X6200_VFO_A ? x6200_vfoa_mode : x6200_vfob_mode);
+}
+
+static int32_t state_passband(x6200_vfo_t vfo)
+{
+    int16_t low, high;
+
+    if (pending.has_mode[vfo] && pending.passband[vfo] > 0) {
+        return pending.passband[vfo];
+    }
+    x6200_control_filter_bank_get(x6200_control_filter_group(state_mode(vfo)), &low, &high);
+    return high - low;
+}
+
+static bool state_split()
+{
+    if (pending.has_split) {
+        return pending.split;
+    }
+    return (x6200_control_get(x6200_sple_atue_trx) & x6200_sple) != 0;
+}
+
+static bool state_ptt()
+{
+    if (pending.has_ptt) {
+        return pending.ptt;
+    }
+    return (x6200_control_get(x6200_sple_atue_trx) & x6200_iptt) != 0;
+}
+
+static float state_pwr()
+{
+    if (pending.has_pwr) {
+        return pending.pwr;
+    }
+    return ((x6200_control_get(x6200_rfg_txpwr) >> 8) & 0xFF) / 10.0f;
+}
+
+static int state_dbm()
+{
+    return have_pack ? METER_ZERO_DBM + last_pack.dbm : METER_ZERO_DBM;
+}
+
+static float state_swr()
+{
+    return have_pack && last_pack.flag.tx && last_pack.vswr >= 10 ? last_pack.vswr / 10.0f : 1.0f;
+}
+
+static float state_tx_watts()
+{
+    return have_pack && last_pack.flag.tx ? last_pack.tx_power / 10.0f : 0.0f;
+}
+
+/* Flush pending writes */
+
+static void flush(void *arg)
+{
+    (void)arg;
+
+    if (pending.has_ptt && !pending.ptt) {
+        x6200_control_ptt_set(false);
+    }
+    if (pending.has_vfo) {
+        x6200_control_vfo_set(pending.vfo);
+    }
+
+    for (int vfo = X6200_VFO_A; vfo <= X6200_VFO_B; vfo++) {
+        if (pending.has_mode[vfo]) {
+            x6200_mode_t mode = pending.mode[vfo];
+
+            if (pending.passband[vfo] > 0) {
+                x6200_filter_group_t    group = x6200_control_filter_group(mode);
+                int16_t                 low, high;
+
+                x6200_control_filter_bank_get(group, &low, &high);
+                x6200_control_filter_bank_set(group, low, low + pending.passband[vfo]);
+            }
+            x6200_control_vfo_mode_set(vfo, mode);
+        }
+        if (pending.has_freq[vfo]) {
+            x6200_control_vfo_freq_set(vfo, pending.freq[vfo]);
+        }
+    }
+
+    if (pending.has_split) {
+        x6200_control_split_set(pending.split);
+    }
+    if (pending.has_pwr) {
+        x6200_control_txpwr_set(pending.pwr);
+    }
+
+    /* PTT on goes last, so TX starts with new frequency and mode */
+
+    if (pending.has_ptt && pending.ptt) {
+        x6200_control_ptt_set(true);
+    }
+
+    memset(&pending, 0, sizeof(pending));
+    stats.flushes++;
+}
+
+static void schedule()
+{
+    stats.sets++;
+
+    if (pending.scheduled) {
+        return;
+    }
+    pending.scheduled = true;
+
+    if (coalesce_ms == 0 || x6200_loop_timer_add(coalesce_ms, false, flush, NULL) < 0) {
+        x6200_loop_post(flush, NULL);
+    }
+}
+
+static void set_freq(x6200_vfo_t vfo, uint32_t freq)
+{
+    pending.has_freq[vfo] = true;
+    pending.freq[vfo] = freq;
+    schedule();
+}
+
+static void set_mode(x6200_vfo_t vfo, x6200_mode_t mode, int32_t passband)
+{
+    pending.has_mode[vfo] = true;
+    pending.mode[vfo] = mode;
+    pending.passband[vfo] = passband;
+    schedule();
+}
+
+static void set_vfo(x6200_vfo_t vfo)
+{
+    pending.has_vfo = true;
+    pending.vfo = vfo;
+    schedule();
+}
+
+static void set_split(bool on)
+{
+    pending.has_split = true;
+    pending.split = on;
+    schedule();
+}
+
+static void set_ptt(bool on)
+{
+    pending.has_ptt = true;
+    pending.ptt = on;
+    schedule();
+}
+
+static void set_pwr(float pwr)
+{
+    pending.has_pwr = true;
+    pending.pwr = pwr < 0.0f ? 0.0f : pwr > MAX_POWER ? MAX_POWER : pwr;
+    schedule();
+}
+
+/* Output */
+
+static void out(client_t *c, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void out(client_t *c, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    int n = vsnprintf(c->out + c->out_len, OUT_SIZE - c->out_len, fmt, args);
+    va_end(args);
+
+    if (n > 0) {
+        c->out_len += (size_t)n < OUT_SIZE - c->out_len ? (size_t)n : OUT_SIZE - c->out_len - 1;
+    }
+}
+
+/* Hamlib rigctld */
+
+static const char *hamlib_mode(x6200_mode_t mode)
+{
+    for (size_t i = 0; i < MODES_COUNT; i++) {
+        if (modes[i].mode == mode) {
+            return modes[i].hamlib;
+        }
+    }
+    return "USB";
+}
+
+static bool parse_vfo(const char *s, x6200_vfo_t *vfo)
+{
+    if (!s || strcasecmp(s, "currVFO") == 0 || strcasecmp(s, "VFO") == 0 || strcasecmp(s, "Main") == 0) {
+        *vfo = state_vfo();
+    } else if (strcasecmp(s, "VFOA") == 0) {
+        *vfo = X6200_VFO_A;
+    } else if (strcasecmp(s, "VFOB") == 0 || strcasecmp(s, "Sub") == 0) {
+        *vfo = X6200_VFO_B;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void dump_state(client_t *c)
+{
+    /* Protocol 1: fixed part, then key=value pairs until "done" */
+
+    out(c, "1\n2\n2\n");
+    out(c, "100000.000000 60000000.000000 0xeef -1 -1 0x3 0x0\n");
+    out(c, "0 0 0 0 0 0 0\n");
+    out(c, "1800000.000000 54000000.000000 0xeef 100 %d 0x3 0x0\n", (int)(MAX_POWER * 1000));
+    out(c, "0 0 0 0 0 0 0\n");
+    out(c, "0xeef 1\n0xeef 10\n0xeef 100\n0 0\n");
+    out(c, "0xc0f 2700\n0x82 500\n0x221 6000\n0x20 12000\n0x40 200000\n0 0\n");
+    out(c, "9990\n9990\n0\n0\n");
+    out(c, "\n\n");
+    out(c, "0x0\n0x0\n0x50001000\n0x1000\n0x0\n0x0\n");
+    out(c, "vfo_ops=0x0\nptt_type=0x1\nhas_set_vfo=1\nhas_get_vfo=1\ndone\n");
+}
+
+static void rigctl_level(client_t *c, const char *name)
+{
+    if (!name) {
+        out(c, "RPRT %d\n", RIG_EINVAL);
+    } else if (strcasecmp(name, "STRENGTH") == 0) {
+        out(c, "%d\n", state_dbm() - S9_DBM);
+    } else if (strcasecmp(name, "SWR") == 0) {
+        out(c, "%.1f\n", state_swr());
+    } else if (strcasecmp(name, "RFPOWER") == 0) {
+        out(c, "%.2f\n", state_pwr() / MAX_POWER);
+    } else if (strcasecmp(name, "RFPOWER_METER") == 0) {
+        out(c, "%.2f\n", state_tx_watts() / MAX_POWER);
+    } else if (strcasecmp(name, "RFPOWER_METER_WATTS") == 0) {
+        out(c, "%.1f\n", state_tx_watts());
+    } else if (strcasecmp(name, "ALC") == 0) {
+        out(c, "%.2f\n", have_pack && last_pack.flag.tx ? last_pack.alc_level / 100.0f : 0.0f);
+    } else {
+        out(c, "RPRT %d\n", RIG_ENAVAIL);
+    }
+}
+
+/* False - close connection */
+
+static bool rigctl_line(client_t *c, char *line)
+{
+    char    *save;
+    char    *cmd = strtok_r(line, " \t\r", &save);
+    char    *a1 = strtok_r(NULL, " \t\r", &save);
+    char    *a2 = strtok_r(NULL, " \t\r", &save);
+    int     res = RIG_OK;
+
+    if (!cmd) {
+        return true;
+    }
+    if (cmd[0] == '+' || cmd[0] == ';' || cmd[0] == '|' || cmd[0] == ',') {
+        cmd++;
+    }
+    stats.commands++;
+
+    x6200_vfo_t vfo = state_vfo();
+
+    if (strcmp(cmd, "f") == 0 || strcmp(cmd, "\\get_freq") == 0) {
+        out(c, "%u\n", state_freq(vfo));
+        return true;
+    } else if (strcmp(cmd, "m") == 0 || strcmp(cmd, "\\get_mode") == 0) {
+        out(c, "%s\n%d\n", hamlib_mode(state_mode(vfo)), state_passband(vfo));
+        return true;
+    } else if (strcmp(cmd, "v") == 0 || strcmp(cmd, "\\get_vfo") == 0) {
+        out(c, "%s\n", vfo == X6200_VFO_A ? "VFOA" : "VFOB");
+        return true;
+    } else if (strcmp(cmd, "t") == 0 || strcmp(cmd, "\\get_ptt") == 0) {
+        out(c, "%d\n", state_ptt());
+        return true;
+    } else if (strcmp(cmd, "s") == 0 || strcmp(cmd, "\\get_split_vfo") == 0) {
+        out(c, "%d\n%s\n", state_split(), vfo == X6200_VFO_A ? "VFOB" : "VFOA");
+        return true;
+    } else if (strcmp(cmd, "i") == 0 || strcmp(cmd, "\\get_split_freq") == 0) {
+        out(c, "%u\n", state_freq(!vfo));
+        return true;
+    } else if (strcmp(cmd, "x") == 0 || strcmp(cmd, "\\get_split_mode") == 0) {
+        out(c, "%s\n%d\n", hamlib_mode(state_mode(!vfo)), state_passband(!vfo));
+        return true;
+    } else if (strcmp(cmd, "l") == 0 || strcmp(cmd, "\\get_level") == 0) {
+        rigctl_level(c, a1);
+        return true;
+    } else if (strcmp(cmd, "_") == 0 || strcmp(cmd, "\\get_info") == 0) {
+        out(c, "Xiegu X6200\n");
+        return true;
+    } else if (strcmp(cmd, "\\get_powerstat") == 0) {
+        out(c, "1\n");
+        return true;
+    } else if (strcmp(cmd, "\\chk_vfo") == 0) {
+        out(c, "0\n");
+        return true;
+    } else if (strcmp(cmd, "\\dump_state") == 0) {
+        dump_state(c);
+        return true;
+    } else if (strcmp(cmd, "q") == 0 || strcmp(cmd, "Q") == 0 || strcmp(cmd, "\\quit") == 0) {
+        return false;
+    }
+
+    /* Sets answer with RPRT */
+
+    if (strcmp(cmd, "F") == 0 || strcmp(cmd, "\\set_freq") == 0) {
+        double freq = a1 ? strtod(a1, NULL) : 0.0;
+
+        if (freq > 0.0) {
+            set_freq(vfo, (uint32_t)(freq + 0.5));
+        } else {
+            res = RIG_EINVAL;
+        }
+    } else if (strcmp(cmd, "I") == 0 || strcmp(cmd, "\\set_split_freq") == 0) {
+        double freq = a1 ? strtod(a1, NULL) : 0.0;
+
+        if (freq > 0.0) {
+            set_freq(!vfo, (uint32_t)(freq + 0.5));
+        } else {
+            res = RIG_EINVAL;
+        }
+    } else if (strcmp(cmd, "M") == 0 || strcmp(cmd, "\\set_mode") == 0 ||
+               strcmp(cmd, "X") == 0 || strcmp(cmd, "\\set_split_mode") == 0) {
+        x6200_vfo_t target = (cmd[0] == 'X' || strstr(cmd, "split")) ? !vfo : vfo;
+        size_t      i;
+
+        for (i = 0; a1 && i < MODES_COUNT; i++) {
+            if (strcasecmp(a1, modes[i].hamlib) == 0) {
+                break;
+            }
+        }
+        if (a1 && i < MODES_COUNT) {
+            set_mode(target, modes[i].mode, a2 ? atoi(a2) : 0);
+        } else {
+            res = RIG_EINVAL;
+        }
+    } else if (strcmp(cmd, "V") == 0 || strcmp(cmd, "\\set_vfo") == 0) {
+        x6200_vfo_t next;
+
+        if (a1 && parse_vfo(a1, &next)) {
+            set_vfo(next);
+        } else {
+            res = RIG_EINVAL;
+        }
+    } else if (strcmp(cmd, "T") == 0 || strcmp(cmd, "\\set_ptt") == 0) {
+        if (a1) {
+            set_ptt(atoi(a1) != 0);
+        } else {
+            res = RIG_EINVAL;
+        }
+    } else if (strcmp(cmd, "S") == 0 || strcmp(cmd, "\\set_split_vfo") == 0) {
+        if (a1) {
+            set_split(atoi(a1) != 0);
+        } else {
+            res = RIG_EINVAL;
+        }
+    } else if (strcmp(cmd, "L") == 0 || strcmp(cmd, "\\set_level") == 0) {
+        if (a1 && a2 && strcasecmp(a1, "RFPOWER") == 0) {
+            set_pwr(strtof(a2, NULL) * MAX_POWER);
+        } else {
+            res = a1 && a2 ? RIG_ENAVAIL : RIG_EINVAL;
+        }
+    } else if (strcmp(cmd, "\\set_powerstat") == 0) {
+        res = RIG_OK;
+    } else {
+        res = RIG_ENAVAIL;
+    }
+
+    out(c, "RPRT %d\n", res);
+    return true;
+}
+
+/* Kenwood TS-2000 */
+
+static uint8_t kenwood_mode(x6200_mode_t mode)
+{
+    for (size_t i = 0; i < MODES_COUNT; i++) {
+        if (modes[i].mode == mode && modes[i].kenwood) {
+            return modes[i].kenwood;
+        }
+    }
+    return mode == x6200_mode_wfm ? 4 : 5;
+}
+
+/* S-meter 0 - 30: S0 - S9 is 0 - 15, S9 - S9+60 dB is 15 - 30 */
+
+static int kenwood_smeter()
+{
+    int dbm = state_dbm();
+    int val;
+
+    if (dbm <= S9_DBM) {
+        val = (dbm - METER_ZERO_DBM) * 15 / (S9_DBM - METER_ZERO_DBM);
+    } else {
+        val = 15 + (dbm - S9_DBM) * 15 / 60;
+    }
+    return val < 0 ? 0 : val > 30 ? 30 : val;
+}
+
+static void kenwood_cmd(client_t *c, char *cmd)
+{
+    size_t      len = strlen(cmd);
+    char        *arg = cmd + 2;
+    x6200_vfo_t vfo = state_vfo();
+
+    if (len < 2) {
+        return;
+    }
+    stats.commands++;
+
+    cmd[0] = toupper((unsigned char)cmd[0]);
+    cmd[1] = toupper((unsigned char)cmd[1]);
+
+    if (strncmp(cmd, "FA", 2) == 0 || strncmp(cmd, "FB", 2) == 0) {
+        x6200_vfo_t target = cmd[1] == 'A' ? X6200_VFO_A : X6200_VFO_B;
+
+        if (*arg) {
+            set_freq(target, strtoul(arg, NULL, 10));
+        } else {
+            out(c, "F%c%011u;", cmd[1], state_freq(target));
+        }
+    } else if (strncmp(cmd, "MD", 2) == 0) {
+        if (*arg) {
+            int m = atoi(arg);
+
+            /* Modes without Kenwood code are not reachable */
+
+            for (size_t i = 0; i < MODES_COUNT; i++) {
+                if (modes[i].kenwood != 0 && modes[i].kenwood == m) {
+                    set_mode(vfo, modes[i].mode, 0);
+                    return;
+                }
+            }
+            out(c, "?;");
+        } else {
+            out(c, "MD%u;", kenwood_mode(state_mode(vfo)));
+        }
+    } else if (strncmp(cmd, "FR", 2) == 0 || strncmp(cmd, "FT", 2) == 0) {
+        if (*arg) {
+            x6200_vfo_t next = *arg == '1' ? X6200_VFO_B : X6200_VFO_A;
+
+            if (cmd[1] == 'R') {
+                set_vfo(next);
+            } else {
+                set_split(next != vfo);
+            }
+        } else if (cmd[1] == 'R') {
+            out(c, "FR%d;", vfo);
+        } else {
+            out(c, "FT%d;", state_split() ? !vfo : vfo);
+        }
+    } else if (strncmp(cmd, "TX", 2) == 0) {
+        set_ptt(true);
+    } else if (strncmp(cmd, "RX", 2) == 0) {
+        set_ptt(false);
+    } else if (strncmp(cmd, "IF", 2) == 0) {
+        int16_t rit = x6200_control_get(x6200_rit);
+        bool    split = state_split();
+
+        out(c, "IF%011u     %+05d%d%d%d%02d%d%u%d%d%d%d%02d%d;",
+            state_freq(vfo), rit, rit != 0, x6200_control_get(x6200_xit) != 0, 0, 0,
+            state_ptt(), kenwood_mode(state_mode(vfo)), vfo, 0, split, 0, 0, 0);
+    } else if (strncmp(cmd, "SM", 2) == 0) {
+        out(c, "SM0%04d;", kenwood_smeter());
+    } else if (strncmp(cmd, "RM", 2) == 0) {
+        int swr = (state_swr() - 1.0f) * 10.0f;
+
+        out(c, "RM1%04d;", swr < 0 ? 0 : swr > 30 ? 30 : swr);
+    } else if (strncmp(cmd, "PC", 2) == 0) {
+        if (*arg) {
+            set_pwr(atoi(arg) * MAX_POWER / 100.0f);
+        } else {
+            out(c, "PC%03d;", (int)(state_pwr() * 100.0f / MAX_POWER + 0.5f));
+        }
+    } else if (strncmp(cmd, "ID", 2) == 0) {
+        out(c, "ID019;");
+    } else if (strncmp(cmd, "PS", 2) == 0) {
+        if (!*arg) {
+            out(c, "PS1;");
+        }
+    } else if (strncmp(cmd, "AI", 2) == 0) {
+        if (!*arg) {
+            out(c, "AI0;");
+        }
+    } else {
+        out(c, "?;");
+    }
+}
+
+/* Clients */
+
+static void client_close(client_t *c)
+{
+    x6200_loop_fd_remove(c->fd);
+    close(c->fd);
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i] == c) {
+            clients[i] = NULL;
+        }
+    }
+    free(c);
+}
+
+/* Non-blocking: what the socket doesn't take is kept until EPOLLOUT */
+
+static bool client_send(client_t *c)
+{
+    size_t done = 0;
+
+    while (done < c->out_len) {
+        ssize_t n = send(c->fd, c->out + done, c->out_len - done, MSG_NOSIGNAL);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    c->out_len -= done;
+    memmove(c->out, c->out + done, c->out_len);
+
+    bool wait = c->out_len > 0;
+
+    if (wait != c->out_wait) {
+        c->out_wait = wait;
+        return x6200_loop_fd_modify(c->fd, wait ? EPOLLIN | EPOLLOUT : EPOLLIN);
+    }
+    return true;
+}
+
+/* All complete commands of one read are answered with one send. Client which doesn't read
+   its answers is dropped when the output buffer is half full */
+
+static void client_read(int fd, uint32_t events, void *user)
+{
+    client_t *c = user;
+
+    if ((events & EPOLLOUT) && !client_send(c)) {
+        client_close(c);
+        return;
+    }
+    if (!(events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+        return;
+    }
+
+    while (true) {
+        ssize_t n = recv(fd, c->in + c->in_len, IN_SIZE - 1 - c->in_len, MSG_DONTWAIT);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n <= 0) {
+            client_close(c);
+            return;
+        }
+        c->in_len += n;
+
+        char    delim = c->proto == PROTO_RIGCTL ? '\n' : ';';
+        char    *start = c->in;
+        char    *end;
+
+        while ((end = memchr(start, delim, c->in + c->in_len - start)) != NULL) {
+            *end = '\0';
+
+            if (c->proto == PROTO_RIGCTL) {
+                if (!rigctl_line(c, start)) {
+                    client_send(c);
+                    client_close(c);
+                    return;
+                }
+            } else {
+                kenwood_cmd(c, start);
+            }
+            start = end + 1;
+
+            if (c->out_len > OUT_SIZE / 2 && (!client_send(c) || c->out_len > OUT_SIZE / 2)) {
+                client_close(c);
+                return;
+            }
+        }
+
+        c->in_len -= start - c->in;
+        memmove(c->in, start, c->in_len);
+
+        if (c->in_len == IN_SIZE - 1) {
+            c->in_len = 0;
+        }
+    }
+
+    if (c->out_len && !client_send(c)) {
+        client_close(c);
+    }
+}
+
+static void client_accept(int fd, uint32_t events, void *user)
+{
+    listener_t  *l = user;
+    int         client_fd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    int         one = 1;
+
+    (void)events;
+
+    if (client_fd < 0) {
+        return;
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i]) {
+            continue;
+        }
+
+        client_t *c = calloc(1, sizeof(client_t));
+
+        if (!c) {
+            break;
+        }
+        c->fd = client_fd;
+        c->proto = l->proto;
+
+        if (!x6200_loop_fd_add(client_fd, EPOLLIN, client_read, c)) {
+            free(c);
+            break;
+        }
+        setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        clients[i] = c;
+        return;
+    }
+
+    printf("Client rejected\n");
+    close(client_fd);
+}
+
+/* Listeners */
+
+static bool listen_on(listener_t *l, proto_t proto, struct sockaddr *addr, socklen_t len)
+{
+    int one = 1;
+
+    l->fd = socket(addr->sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    l->proto = proto;
+
+    if (l->fd < 0) {
+        perror("Can't create socket");
+        return false;
+    }
+    setsockopt(l->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(l->fd, addr, len) < 0 || listen(l->fd, 4) < 0) {
+        perror("Can't listen");
+        close(l->fd);
+        l->fd = -1;
+        return false;
+    }
+    return x6200_loop_fd_add(l->fd, EPOLLIN, client_accept, l);
+}
+
+static bool listen_tcp(listener_t *l, proto_t proto, const char *host, uint16_t port)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+    };
+
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        printf("Wrong address %s\n", host);
+        return false;
+    }
+    return listen_on(l, proto, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+static bool listen_unix(listener_t *l, proto_t proto, const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Socket path too long\n");
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    return listen_on(l, proto, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+/* Loop callbacks */
+
+static void packet(const x6200_flow_t *pack, void *user) {
+    (void)user;
+
+    last_pack = *pack;
+    have_pack = true;
+}
+
+static void on_signal(int sig) {
+    (void)sig;
+
+    x6200_loop_stop();
+}
+
+int main(int argc, char *argv[]) {
+    const char  *host = "127.0.0.1";
+    int         rigctl_port = 4532;
+    int         kenwood_port = 4533;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "a:p:k:u:c:")) != -1) {
+        switch (opt) {
+            case 'a':
+                host = optarg;
+                break;
+
+            case 'p':
+                rigctl_port = atoi(optarg);
+                break;
+
+            case 'k':
+                kenwood_port = atoi(optarg);
+                break;
+
+            case 'u':
+                unix_path = optarg;
+                break;
+
+            case 'c':
+                coalesce_ms = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-a addr] [-p rigctld port] [-k kenwood port, 0 - off] "
+                        "[-u unix socket] [-c coalesce ms]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    x6200_loop_config_t conf = {
+        .packet = packet,
+        .flow_timeout_ms = 500,
+    };
+
+    if (!x6200_control_init())
+        return 1;
+
+    if (!x6200_flow_init())
+        return 1;
+
+    if (!x6200_loop_init(&conf))
+        return 1;
+
+    if (rigctl_port && !listen_tcp(&listeners[0], PROTO_RIGCTL, host, rigctl_port))
+        return 1;
+
+    if (kenwood_port && !listen_tcp(&listeners[1], PROTO_KENWOOD, host, kenwood_port))
+        return 1;
+
+    if (unix_path && !listen_unix(&listeners[2], PROTO_RIGCTL, unix_path))
+        return 1;
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    printf("rigctld on %s:%d, kenwood on %s:%d\n", host, rigctl_port, host, kenwood_port);
+    x6200_loop_run();
+
+    if (pending.scheduled) {
+        flush(NULL);
+    }
+    printf("Commands %llu, sets %llu, bus flushes %llu\n",
+           (unsigned long long)stats.commands, (unsigned long long)stats.sets, (unsigned long long)stats.flushes);
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i]) {
+            client_close(clients[i]);
+        }
+    }
+    x6200_loop_close();
+
+    if (unix_path) {
+        unlink(unix_path);
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+/*
+ * Spectrum codec harness. Records flow packets, then codes them with several quantization
+ * steps. One JSON object per step: size ratio against raw samples, kbit/s at 35 ms per line,
+ * encode and decode time per line, max error.
+ *
+ *   x6200_codec [-n packets]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <aether_radio/x6200_control/codec.h>
+#include <aether_radio/x6200_control/control.h>
+#include <aether_radio/x6200_control/low/flow.h>
+
+#define LINE_MS 35.0
+
+static const float steps[] = { 0.25f, 0.5f, 1.0f, 2.0f, 3.0f };
+
+static double now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+int main(int argc, char *argv[]) {
+    int     count = 300;
+    int     opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') {
+            count = atoi(optarg);
+        } else {
+            fprintf(stderr, "Usage: %s [-n packets]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    float   (*lines)[X6200_CODEC_BINS] = calloc(count, sizeof(*lines));
+    uint8_t buf[X6200_CODEC_MAX_SIZE];
+
+    if (!lines || !x6200_control_init())
+        return 1;
+
+    if (!x6200_flow_init())
+        return 1;
+
+    double spectrum_us = 0.0;
+
+    for (int i = 0; i < count;) {
+        x6200_flow_t pack;
+
+        if (x6200_flow_read(&pack)) {
+            double t = now_us();
+
+            x6200_codec_spectrum(&pack, lines[i++]);
+            spectrum_us += now_us() - t;
+        } else {
+            usleep(1000);
+        }
+    }
+    printf("{\"name\":\"spectrum\",\"count\":%d,\"mean_us\":%.3f}\n", count, spectrum_us / count);
+
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+        x6200_codec_config_t    conf = { .step_db = steps[s] };
+        x6200_codec_t           enc, dec;
+        double                  enc_us = 0.0, dec_us = 0.0;
+        size_t                  bytes = 0;
+        float                   max_err = 0.0f;
+        int                     broken = 0;
+
+        x6200_codec_init(&enc, &conf);
+        x6200_codec_init(&dec, &conf);
+
+        for (int i = 0; i < count; i++) {
+            float   out[X6200_CODEC_BINS];
+            double  t = now_us();
+            size_t  len = x6200_codec_encode(&enc, lines[i], buf);
+
+            enc_us += now_us() - t;
+            bytes += len;
+
+            t = now_us();
+
+            if (!x6200_codec_decode(&dec, buf, len, out)) {
+                broken++;
+                continue;
+            }
+            dec_us += now_us() - t;
+
+            for (int n = 0; n < X6200_CODEC_BINS; n++) {
+                float err = fabsf(out[n] - lines[i][n]);
+
+                if (err > max_err) {
+                    max_err = err;
+                }
+            }
+        }
+
+        double avg = (double)bytes / count;
+
+        printf("{\"name\":\"step_%.2f\",\"count\":%d,\"bytes\":%.1f,\"ratio\":%.2f,\"kbit_s\":%.1f,"
+               "\"encode_us\":%.3f,\"decode_us\":%.3f,\"max_err_db\":%.3f,\"broken\":%d}\n",
+               steps[s], count, avg, sizeof(((x6200_flow_t *)0)->samples) / avg, avg * 8 / LINE_MS,
+               enc_us / count, dec_us / count, max_err, broken);
+    }
+
+    free(lines);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+/*
+ * Keyer profile written with C setters and with x6200::update<>. Bus transfers and time
+ * per profile, on the in-process transport by default:
+ *
+ *   x6200_fields [-t mem|kernel|file] [-n iterations]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+
+#include <aether_radio/x6200_control/control.hpp>
+
+extern "C" {
+#include <aether_radio/x6200_control/low/transport.h>
+}
+
+using namespace x6200::fields;
+
+static double now_us() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static void profile_c(uint32_t i) {
+    x6200_control_key_speed_set(20 + i % 10);
+    x6200_control_key_mode_set(x6200_key_auto_left);
+    x6200_control_iambic_mode_set(x6200_iambic_b);
+    x6200_control_key_tone_set(600 + i % 100);
+    x6200_control_key_vol_set(20);
+    x6200_control_qsk_time_set(100);
+    x6200_control_key_ratio_set(3.0f);
+}
+
+static void profile_cxx(uint32_t i) {
+    x6200::batch(
+        x6200::cmd<key_speed, key_mode, iambic_mode, key_tone, key_vol>(
+            20 + i % 10, x6200::key_mode::auto_left, x6200::iambic_mode::b, 600 + i % 100, 20),
+        x6200::cmd<qsk_time, key_ratio>(100, 30)
+    );
+}
+
+static void run(const char *name, void (*fn)(uint32_t), uint32_t iterations) {
+    x6200_control_bus_stats_t   before, after;
+    double                      start = now_us();
+
+    x6200_control_bus_stats(&before);
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn(i);
+    }
+
+    x6200_control_bus_stats(&after);
+
+    printf("%-6s %.1f transfers, %.1f us per profile\n", name,
+           (double) (after.transfers - before.transfers) / iterations, (now_us() - start) / iterations);
+}
+
+int main(int argc, char *argv[]) {
+    const char  *transport = "mem";
+    uint32_t    iterations = 2000;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "t:n:")) != -1) {
+        switch (opt) {
+            case 't':
+                transport = optarg;
+                break;
+
+            case 'n':
+                iterations = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-t mem|kernel|file] [-n iterations]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (iterations == 0 || !x6200_transport_select(transport)) {
+        return 1;
+    }
+
+    x6200::control control;
+
+    if (!control) {
+        return 1;
+    }
+
+    run("C", profile_c, iterations);
+    uint32_t c_reg[] = { x6200_control_get(x6200_ks_km_kimb_cwtone_cwvol_cwtrain), x6200_control_get(x6200_qsktime_kr) };
+
+    run("C++", profile_cxx, iterations);
+    uint32_t cxx_reg[] = { x6200_control_get(x6200_ks_km_kimb_cwtone_cwvol_cwtrain), x6200_control_get(x6200_qsktime_kr) };
+
+    if (c_reg[0] != cxx_reg[0] || c_reg[1] != cxx_reg[1]) {
+        printf("Registers differ: %08X %08X vs %08X %08X\n", c_reg[0], c_reg[1], cxx_reg[0], cxx_reg[1]);
+        return 1;
+    }
+
+    printf("key tone %u Hz, ratio %.1f\n", x6200::get<key_tone>(), x6200::get<key_ratio>() * 0.1f);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+/*
+ * GPIO timing harness. Latency of single line change of the light line. With -a also light +
+ * USB + BB reset as three calls and as one x6200_gpio_set_many(). Toggling USB power and BB
+ * reset restarts the BASE board, so use -a on gpio-sim only. One JSON object per line.
+ *
+ *   x6200_gpio_bench [-a]
+ *
+ * With gpio-sim instead of real chips:
+ *
+ *   modprobe gpio-sim
+ *   cd /sys/kernel/config/gpio-sim && mkdir x6200 x6200/gpio-bank0 x6200/gpio-bank1
+ *   echo 8 > x6200/gpio-bank0/num_lines && echo 256 > x6200/gpio-bank1/num_lines
+ *   echo 1 > x6200/live
+ *   X6200_GPIO_CHIP0=$(cat x6200/gpio-bank0/chip_name) X6200_GPIO_CHIP1=$(cat x6200/gpio-bank1/chip_name) x6200_gpio_bench
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <aether_radio/x6200_control/low/gpio.h>
+
+#define ITERATIONS 10000
+
+static float samples[ITERATIONS];
+
+static double now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static int cmp_float(const void *a, const void *b)
+{
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name)
+{
+    double sum = 0.0;
+
+    qsort(samples, ITERATIONS, sizeof(float), cmp_float);
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        sum += samples[i];
+    }
+    printf("{\"name\":\"%s\",\"count\":%d,\"mean_us\":%.3f,\"p50_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f}\n",
+           name, ITERATIONS, sum / ITERATIONS, samples[ITERATIONS / 2], samples[ITERATIONS * 99 / 100],
+           samples[ITERATIONS - 1]);
+}
+
+int main(int argc, char *argv[]) {
+    const uint32_t  mask = X6200_GPIO_BIT(X6200_GPIO_LIGHT) | X6200_GPIO_BIT(X6200_GPIO_USB) |
+                           X6200_GPIO_BIT(X6200_GPIO_BB_RESET);
+    bool            all = false;
+    int             opt;
+
+    while ((opt = getopt(argc, argv, "a")) != -1) {
+        switch (opt) {
+            case 'a':
+                all = true;
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-a]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!x6200_gpio_init())
+        return 1;
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        double t = now_us();
+
+        x6200_gpio_set(x6200_pin_light, i & 1);
+        samples[i] = now_us() - t;
+    }
+    report("set_single");
+    x6200_gpio_set(x6200_pin_light, 0);
+
+    if (!all)
+        return 0;
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        double t = now_us();
+
+        x6200_gpio_set(x6200_pin_light, i & 1);
+        x6200_gpio_set(x6200_pin_usb, i & 1);
+        x6200_gpio_set(x6200_pin_bb_reset, i & 1);
+        samples[i] = now_us() - t;
+    }
+    report("set_three");
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        double t = now_us();
+
+        x6200_gpio_set_many(mask, i & 1 ? mask : 0);
+        samples[i] = now_us() - t;
+    }
+    report("set_many_three");
+
+    x6200_gpio_set_many(mask, 0);
+    return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+
+#include <aether_radio/x6200_control/control.h>
+#include <aether_radio/x6200_control/keyer.h>
+#include <aether_radio/x6200_control/low/gpio.h>
+
+int main(int argc, char *argv[]) {
+    x6200_keyer_config_t    conf = { .wpm = 40, .weight = 50, .ratio = 3.0f, .priority = 50 };
+    x6200_keyer_stats_t     stats;
+
+    if (!x6200_control_init())
+        return 1;
+
+    if (!x6200_gpio_init())
+        return 1;
+
+    if (!x6200_keyer_start(&conf))
+        return 1;
+
+    x6200_keyer_send_text(argc > 1 ? argv[1] : "CQ TEST DE R1CBU R1CBU TEST");
+
+    while (x6200_keyer_busy()) {
+        usleep(100000);
+    }
+
+    x6200_keyer_stats(&stats);
+    printf("edges=%u jitter avg=%.1f us max=%.1f us\n", stats.edges, stats.jitter_avg_us, stats.jitter_max_us);
+
+    x6200_keyer_stop();
+}
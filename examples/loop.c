@@ -0,0 +1,77 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#include <stdio.h>
+
+#include <aether_radio/x6200_control/control.h>
+#include <aether_radio/x6200_control/loop.h>
+#include <aether_radio/x6200_control/low/flow.h>
+#include <aether_radio/x6200_control/low/gpio.h>
+
+static const uint32_t freqs[] = { 7074000, 10136000, 14074000 };
+
+static int band = 0;
+
+static void packet(const x6200_flow_t *pack, void *user) {
+    (void)user;
+
+    static int count = 0;
+
+    if (count++ % 30 == 0) {
+        printf("tx=%d dbm=%d vext=%.1f vbat=%.1f bat=%d\n",
+               pack->flag.tx, pack->dbm, pack->vext * 0.1f, pack->vbat * 0.1f, pack->batcap);
+    }
+}
+
+static void flags(x6200_flow_flags_t prev, x6200_flow_flags_t flags, void *user) {
+    (void)user;
+
+    if (prev.tx != flags.tx) {
+        printf("--- TX %s ---\n", flags.tx ? "on" : "off");
+    }
+    if (!prev.resync && flags.resync) {
+        printf("--- Resync ---\n");
+    }
+}
+
+static void next_band(void *user) {
+    (void)user;
+
+    band = (band + 1) % 3;
+
+    printf("--- Freq %.3f MHz ---\n", freqs[band] / 1000000.0);
+    x6200_control_vfo_freq_set(X6200_VFO_A, freqs[band]);
+}
+
+int main() {
+    x6200_loop_config_t conf = {
+        .packet = packet,
+        .flags = flags,
+        .flow_timeout_ms = 500,
+    };
+
+    if (!x6200_control_init())
+        return 1;
+
+    if (!x6200_gpio_init())
+        return 1;
+
+    if (!x6200_flow_init())
+        return 1;
+
+    if (!x6200_loop_init(&conf))
+        return 1;
+
+    x6200_control_vfo_mode_set(X6200_VFO_A, x6200_mode_usb_dig);
+    x6200_control_vfo_freq_set(X6200_VFO_A, freqs[band]);
+    x6200_loop_timer_add(7000, true, next_band, NULL);
+
+    x6200_loop_run();
+    x6200_loop_close();
+}
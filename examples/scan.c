@@ -0,0 +1,71 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#include <poll.h>
+#include <stdio.h>
+
+#include <aether_radio/x6200_control/control.h>
+#include <aether_radio/x6200_control/low/flow.h>
+#include <aether_radio/x6200_control/scan.h>
+
+static x6200_flow_t pack;
+
+int main() {
+    if (!x6200_control_init())
+        return 1;
+
+    if (!x6200_flow_init())
+        return 1;
+
+    x6200_control_vfo_mode_set(X6200_VFO_A, x6200_mode_nfm);
+    x6200_control_sql_fm_set(30);
+
+    /* 10m FM segment */
+
+    x6200_scan_config_t conf = {
+        .vfo = X6200_VFO_A,
+        .start = 29520000,
+        .stop = 29700000,
+        .step = 10000,
+        .use_sql = true,
+        .skip_packets = 1,
+        .dwell_packets = 2,
+        .hang_ms = 3000
+    };
+
+    if (!x6200_scan_start(&conf))
+        return 1;
+
+    x6200_scan_state_t prev = X6200_SCAN_IDLE;
+
+    while (true) {
+        struct pollfd pfd = { .fd = x6200_flow_fd(), .events = POLLIN };
+
+        if (poll(&pfd, 1, 1000) == 0) {
+            printf("Flow timeout, restart\n");
+            x6200_flow_restart();
+            continue;
+        }
+
+        if (!x6200_flow_read(&pack)) {
+            continue;
+        }
+
+        x6200_scan_state_t state = x6200_scan_process(&pack);
+
+        if (state == X6200_SCAN_ACTIVE && prev != X6200_SCAN_ACTIVE) {
+            x6200_scan_stats_t stats;
+
+            x6200_scan_stats(&stats);
+            printf("Active %u Hz, %.1f ch/s, settle %.1f ms\n",
+                   x6200_scan_freq(), stats.channels_per_sec, stats.settle_avg_ms);
+        }
+        prev = state;
+    }
+}
@@ -0,0 +1,540 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+/*
+ * BASE board simulator. Serves the register file of the "file" transport and streams
+ * flow packets on a pty at the real cadence:
+ *
+ *   x6200_sim [regs file] [flow link]
+ *   X6200_TRANSPORT=file X6200_I2C_FILE=<regs file> X6200_FLOW_FILE=<flow link> x6200_vfo
+ *
+ * Opening the register file resets the simulated BASE: it publishes base info and calibration
+ * in the info space, then raises the ready flag. SIGUSR1 drops all registers and raises resync,
+ * like a BASE glitch. Info space is read-only for the host and survives both.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <aether_radio/x6200_control/low/control.h>
+#include <aether_radio/x6200_control/low/flow.h>
+#include <aether_radio/x6200_control/low/transport.h>
+
+#define TICK_MS         1
+#define PACKET_MS       35
+#define ATU_TUNE_MS     1500
+
+#define HOST_CMD_ADDR   0xfffe
+#define READY_ADDR      0x2000
+#define CALIB_ADDR      0x100
+#define BASE_INFO_LEN   129
+#define CALIB_LEN       507
+
+#define SAMPLE_RATE     96000.0f
+#define NOISE_DBM       -121.0f
+#define METER_ZERO_DBM  -127.0f
+#define SWRSCAN_POWER   5           /* 0.5 W */
+#define SWR_METER_ALPHA 0.6f
+
+typedef struct {
+    uint32_t        freq;
+    x6200_mode_t    mode;
+    float           dbm;
+} station_t;
+
+/* Antenna: resonances with SWR 1.2, rising to 2.0 at +-1% */
+
+static const uint32_t resonances[] = { 3650000, 7100000, 14150000, 21200000, 28500000 };
+
+static const station_t stations[] = {
+    { 3700000,      x6200_mode_lsb,     -90.0f },
+    { 7030000,      x6200_mode_cw,      -95.0f },
+    { 7074000,      x6200_mode_usb_dig, -85.0f },
+    { 7150000,      x6200_mode_lsb,     -78.0f },
+    { 9500000,      x6200_mode_am,      -65.0f },
+    { 14074000,     x6200_mode_usb_dig, -80.0f },
+    { 14200000,     x6200_mode_usb,     -73.0f },
+    { 28500000,     x6200_mode_usb,     -88.0f },
+    { 29600000,     x6200_mode_nfm,     -70.0f },
+    { 51510000,     x6200_mode_nfm,     -75.0f },
+};
+
+static uint8_t              *regs;          /* Written by host */
+static uint8_t              *info;          /* Read by host */
+static int                  flow_fd;
+static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t glitch = 0;
+
+static uint32_t             prev[x6200_last + 1];
+static uint8_t              calibration[CALIB_LEN];
+
+static bool                 baseband = false;
+static bool                 resync = false;
+static uint64_t             atu_end = 0;
+static uint32_t             atu_params = 0;
+static bool                 prev_tx = false;
+static float                swr_meter;
+static uint64_t             sample_pos = 0;
+
+static uint64_t now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ull + ts.tv_nsec / 1000000;
+}
+
+static uint32_t reg(x6200_cmd_enum_t cmd)
+{
+    uint32_t val;
+
+    memcpy(&val, regs + cmd * 4, sizeof(val));
+    return val;
+}
+
+/* Same CRC as flow parser: CRC-32/MPEG-2 over 32-bit words */
+
+static uint32_t crc32_words(const uint32_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+
+        for (int bit = 0; bit < 32; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static void on_signal(int sig)
+{
+    if (sig == SIGUSR1) {
+        glitch = 1;
+    } else {
+        running = 0;
+    }
+}
+
+/* BASE */
+
+static void base_reset()
+{
+    memset(info, 0, BASE_INFO_LEN);
+    strcpy((char *)info + 0x01, "SIM-FPGA 1.0");
+    strcpy((char *)info + 0x21, "SIM-HW 1.0");
+    strcpy((char *)info + 0x41, "SIM-FW 1.0");
+    strcpy((char *)info + 0x61, __DATE__);
+
+    memcpy(info + CALIB_ADDR, calibration, sizeof(calibration));
+    memcpy(prev, regs, sizeof(prev));
+
+    baseband = false;
+    atu_end = 0;
+    info[READY_ADDR] = 1;
+
+    printf("BASE reset\n");
+}
+
+static void host_cmd(uint16_t cmd, uint64_t now)
+{
+    switch (cmd)
+    {
+    case 0x8002:
+    case 0x8003:
+        baseband = true;
+        printf("Host cmd %04X: baseband running\n", cmd);
+        break;
+
+    case 0x8004:
+        if (reg(x6200_sple_atue_trx) & x6200_atu_tune) {
+            atu_end = now + ATU_TUNE_MS;
+            printf("Host cmd 8004: ATU tune start\n");
+        }
+        break;
+
+    case 0x8005:
+        memcpy(calibration, regs + CALIB_ADDR, sizeof(calibration));
+        memcpy(info + CALIB_ADDR, calibration, sizeof(calibration));
+        printf("Host cmd 8005: calibration saved\n");
+        break;
+
+    default:
+        printf("Host cmd %04X: unknown\n", cmd);
+        break;
+    }
+}
+
+static void check_regs(uint64_t now)
+{
+    uint16_t cmd;
+
+    if (info[READY_ADDR] == 0) {
+        base_reset();
+    }
+
+    /* Latest host command only, older one is lost if it is overwritten within a tick */
+
+    memcpy(&cmd, regs + HOST_CMD_ADDR, sizeof(cmd));
+
+    if (cmd) {
+        memset(regs + HOST_CMD_ADDR, 0, sizeof(cmd));
+        host_cmd(cmd, now);
+    }
+
+    if (!baseband) {
+        return;
+    }
+
+    for (int i = 0; i <= x6200_last; i++) {
+        uint32_t val = reg(i);
+
+        if (val != prev[i]) {
+            printf("Reg %2i: %08X -> %08X\n", i, prev[i], val);
+            prev[i] = val;
+
+            if (i == x6200_atu_network && val != 0 && val != atu_params) {
+                atu_params = val;
+                printf("ATU network set: %08X\n", atu_params);
+            }
+        }
+    }
+
+    if (atu_end && now >= atu_end) {
+        atu_end = 0;
+        atu_params = reg(x6200_vfoa_freq) / 1000 ^ 0x5A5A0000;
+        printf("ATU tune done: %08X\n", atu_params);
+    }
+}
+
+/* Flow */
+
+static uint32_t passband(x6200_mode_t mode)
+{
+    switch (mode)
+    {
+    case x6200_mode_cw:
+    case x6200_mode_cwr:
+        return 500;
+
+    case x6200_mode_am:
+    case x6200_mode_sam:
+        return 6000;
+
+    case x6200_mode_nfm:
+        return 12000;
+
+    case x6200_mode_wfm:
+        return 150000;
+
+    default:
+        return 3000;
+    }
+}
+
+/* Audio tones of station relative to carrier, Hz */
+
+static size_t station_tones(const station_t *s, float *tones)
+{
+    switch (s->mode)
+    {
+    case x6200_mode_cw:
+    case x6200_mode_cwr:
+        tones[0] = 0.0f;
+        return 1;
+
+    case x6200_mode_lsb:
+    case x6200_mode_lsb_dig:
+        tones[0] = -700.0f;
+        tones[1] = -1500.0f;
+        tones[2] = -2300.0f;
+        return 3;
+
+    case x6200_mode_am:
+    case x6200_mode_sam:
+        tones[0] = 0.0f;
+        tones[1] = -1000.0f;
+        tones[2] = 1000.0f;
+        return 3;
+
+    case x6200_mode_nfm:
+    case x6200_mode_wfm:
+        tones[0] = -2500.0f;
+        tones[1] = 0.0f;
+        tones[2] = 2500.0f;
+        return 3;
+
+    default:
+        tones[0] = 700.0f;
+        tones[1] = 1500.0f;
+        tones[2] = 2300.0f;
+        return 3;
+    }
+}
+
+static float noise()
+{
+    float sum = 0.0f;
+
+    for (int i = 0; i < 4; i++) {
+        sum += (float)rand() / RAND_MAX - 0.5f;
+    }
+    return sum;
+}
+
+static void fill_spectrum(x6200_flow_t *pack, uint32_t freq)
+{
+    const float noise_amp = 1e-3f;
+    const int   count = sizeof(pack->samples) / sizeof(pack->samples[0]) / 2;
+
+    for (int i = 0; i < count; i++) {
+        pack->samples[i * 2] = noise() * noise_amp;
+        pack->samples[i * 2 + 1] = noise() * noise_amp;
+    }
+
+    for (size_t n = 0; n < sizeof(stations) / sizeof(stations[0]); n++) {
+        const station_t *s = &stations[n];
+        float           offset = (float)s->freq - (float)freq;
+        float           tones[3];
+        size_t          ntones = station_tones(s, tones);
+        float           amp = noise_amp * powf(10.0f, (s->dbm - NOISE_DBM) / 20.0f);
+
+        if (fabsf(offset) > SAMPLE_RATE / 2) {
+            continue;
+        }
+
+        for (size_t k = 0; k < ntones; k++) {
+            float w = 2.0f * (float)M_PI * (offset + tones[k]) / SAMPLE_RATE;
+
+            for (int i = 0; i < count; i++) {
+                float phase = w * (float)((sample_pos + i) % 1000000);
+
+                pack->samples[i * 2] += amp * cosf(phase);
+                pack->samples[i * 2 + 1] += amp * sinf(phase);
+            }
+        }
+    }
+    sample_pos += count;
+}
+
+static float signal_dbm(uint32_t freq, x6200_mode_t mode)
+{
+    float       level = NOISE_DBM;
+    uint32_t    half = passband(mode) / 2;
+
+    for (size_t n = 0; n < sizeof(stations) / sizeof(stations[0]); n++) {
+        const station_t *s = &stations[n];
+        uint32_t        diff = s->freq > freq ? s->freq - freq : freq - s->freq;
+
+        if (diff <= half && s->dbm > level) {
+            level = s->dbm;
+        }
+    }
+    return level;
+}
+
+static float antenna_swr(uint32_t freq)
+{
+    float swr = 99.0f;
+
+    for (size_t n = 0; n < sizeof(resonances) / sizeof(resonances[0]); n++) {
+        float x = ((float)freq - resonances[n]) / (resonances[n] * 0.01f);
+        float v = 1.2f + 0.8f * x * x;
+
+        if (v < swr) {
+            swr = v;
+        }
+    }
+    return swr;
+}
+
+static void send_packet(uint64_t now)
+{
+    x6200_flow_t    pack;
+    bool            fg_b = (reg(x6200_vi_vm) & 0xFF) == 1;
+    uint32_t        freq = reg(fg_b ? x6200_vfob_freq : x6200_vfoa_freq);
+    x6200_mode_t    mode = reg(fg_b ? x6200_vfob_mode : x6200_vfoa_mode);
+    uint32_t        trx = reg(x6200_sple_atue_trx);
+    uint32_t        sql_reg = reg(x6200_micsel_pttmode_chge_spmode_auxiqgen_sqlthr);
+    bool            tuning = atu_end != 0;
+    bool            swrscan = trx & x6200_swrscan_trx;
+    bool            tx = (trx & x6200_iptt) || tuning || swrscan;
+
+    memset(&pack, 0, sizeof(pack));
+    pack.magic = 0xAA5555AA;
+
+    fill_spectrum(&pack, freq);
+
+    float   level = tx ? NOISE_DBM : signal_dbm(freq, mode);
+    float   meter = level - METER_ZERO_DBM;
+    uint8_t sql = mode == x6200_mode_nfm ? (sql_reg >> 16) & 0xFF : (sql_reg >> 8) & 0xFF;
+
+    pack.dbm = meter < 0.0f ? 0 : meter > 255.0f ? 255 : (uint8_t)meter;
+
+    pack.flag.resync = resync;
+    pack.flag.tx = tx;
+    pack.flag.atu_status = (trx & x6200_atue) && atu_params != 0;
+    pack.flag.vext = true;
+    pack.flag.sql_mute = !tx && (sql_reg & (1 << 24)) && pack.dbm < sql;
+
+    if (tx) {
+        bool    matched = (trx & x6200_atue) && atu_params != 0;
+        float   swr = antenna_swr(freq);
+
+        /* SWR meter lags behind retune */
+
+        swr_meter = prev_tx ? swr_meter + (swr - swr_meter) * SWR_METER_ALPHA : swr;
+        swr = swr_meter;
+
+        pack.tx_power = swrscan ? SWRSCAN_POWER : (reg(x6200_rfg_txpwr) >> 8) & 0xFF;
+        pack.vswr = tuning ? 12 + (atu_end - now) * 18 / ATU_TUNE_MS : matched ? 13 : swr > 25.5f ? 255 : swr * 10;
+        pack.alc_level = 10;
+    }
+    prev_tx = tx;
+    pack.vext = 138;
+    pack.vbat = 82;
+    pack.batcap = 90;
+    pack.atu_params = atu_params;
+
+    uint32_t words[sizeof(pack) / 4];
+
+    memcpy(words, &pack, sizeof(pack));
+    pack.crc = crc32_words(words, sizeof(pack) / 4 - 1);
+
+    if (write(flow_fd, &pack, sizeof(pack)) < 0 && errno != EAGAIN) {
+        perror("Flow write");
+    }
+    resync = false;
+}
+
+static int open_pty(const char *link)
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+        perror("Can't open pty");
+        return -1;
+    }
+
+    struct termios attr;
+
+    tcgetattr(fd, &attr);
+    cfmakeraw(&attr);
+    tcsetattr(fd, 0, &attr);
+
+    printf("Flow: %s\n", ptsname(fd));
+
+    if (link) {
+        unlink(link);
+
+        if (symlink(ptsname(fd), link) < 0) {
+            perror("Can't link pty");
+        }
+    }
+    return fd;
+}
+
+static uint8_t *open_regs(const char *path)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0 || ftruncate(fd, X6200_TRANSPORT_FILE_SIZE) < 0) {
+        perror("Can't open register file");
+        return NULL;
+    }
+
+    void *map = mmap(NULL, X6200_TRANSPORT_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        perror("Can't map register file");
+        return NULL;
+    }
+    printf("Regs: %s\n", path);
+    return map;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : getenv("X6200_I2C_FILE");
+    const char *link = argc > 2 ? argv[2] : getenv("X6200_FLOW_FILE");
+
+    regs = open_regs(path ? path : "/tmp/x6200_regs");
+
+    if (!regs)
+        return 1;
+
+    info = regs + X6200_TRANSPORT_REGS_SIZE;
+
+    flow_fd = open_pty(link);
+
+    if (flow_fd < 0)
+        return 1;
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGUSR1, on_signal);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    for (int i = 0; i < CALIB_LEN; i++) {
+        calibration[i] = i;
+    }
+    base_reset();
+
+    struct timespec next;
+    uint64_t        packet_time = now_ms();
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (running) {
+        uint64_t now = now_ms();
+
+        if (glitch) {
+            glitch = 0;
+            memset(regs, 0, (x6200_last + 1) * 4);
+            resync = true;
+            printf("BASE glitch\n");
+        }
+
+        check_regs(now);
+
+        if (baseband && now >= packet_time) {
+            send_packet(now);
+            packet_time += PACKET_MS;
+
+            if (packet_time < now) {
+                packet_time = now + PACKET_MS;
+            }
+        }
+
+        next.tv_nsec += TICK_MS * 1000000;
+
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    if (link) {
+        unlink(link);
+    }
+    return 0;
+}
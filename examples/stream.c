@@ -0,0 +1,258 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+/*
+ * Spectrum streaming server. Every flow packet goes to all destinations, stats and own CPU
+ * usage are printed every 10 seconds.
+ *
+ *   x6200_stream -d 239.62.0.1:50200 -d 192.168.1.10:50200 -b 2
+ *
+ * With -c step the spectrum is sent coded (x6200_codec) with quantization step in dB.
+ *
+ * With -r it is a subscriber instead: joins the group (if multicast), decodes coded lines and
+ * prints lost datagrams and latency.
+ *
+ *   x6200_stream -r 239.62.0.1:50200
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include <aether_radio/x6200_control/codec.h>
+#include <aether_radio/x6200_control/control.h>
+#include <aether_radio/x6200_control/loop.h>
+#include <aether_radio/x6200_control/stream.h>
+#include <aether_radio/x6200_control/low/flow.h>
+
+#define STATS_MS 10000
+
+static double   last_cpu;
+static double   last_wall;
+static uint64_t last_bytes;
+
+static double cpu_sec()
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static double now_sec(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool split_dest(char *arg, char **host, uint16_t *port)
+{
+    char *colon = strrchr(arg, ':');
+
+    *host = arg;
+    *port = X6200_STREAM_PORT;
+
+    if (colon) {
+        *colon = '\0';
+        *port = atoi(colon + 1);
+    }
+    return *port != 0;
+}
+
+static void packet(const x6200_flow_t *pack, void *user) {
+    (void)user;
+
+    x6200_stream_packet(pack);
+}
+
+static void print_stats(void *user) {
+    x6200_stream_stats_t    s;
+    double                  cpu = cpu_sec();
+    double                  wall = now_sec(CLOCK_MONOTONIC);
+
+    (void)user;
+    x6200_stream_stats(&s);
+    printf("packets %u, datagrams %u, syscalls %u, errors %u, %.1f kbit/s, cpu %.2f%%\n",
+           s.packets, s.datagrams, s.syscalls, s.errors, (s.bytes - last_bytes) * 8 / 1000.0 / (wall - last_wall),
+           (cpu - last_cpu) * 100.0 / (wall - last_wall));
+
+    last_cpu = cpu;
+    last_wall = wall;
+    last_bytes = s.bytes;
+}
+
+static void on_signal(int sig) {
+    (void)sig;
+
+    x6200_loop_stop();
+}
+
+static int subscribe(char *dest) {
+    char                    *host;
+    uint16_t                port;
+    int                     sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int                     one = 1;
+    struct sockaddr_in      addr = { .sin_family = AF_INET };
+    static uint8_t          buf[65536];
+    uint32_t                next_seq = 0;
+    uint32_t                lost = 0;
+    uint32_t                broken = 0;
+    bool                    first = true;
+    x6200_codec_t           codec;
+    x6200_codec_config_t    codec_conf = { 0 };
+    float                   db[X6200_CODEC_BINS];
+
+    x6200_codec_init(&codec, &codec_conf);
+
+    if (sock < 0 || !split_dest(dest, &host, &port)) {
+        return 1;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    addr.sin_port = htons(port);
+
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("Can't bind");
+        return 1;
+    }
+
+    struct ip_mreq mreq = { .imr_interface.s_addr = htonl(INADDR_ANY) };
+
+    if (inet_pton(AF_INET, host, &mreq.imr_multiaddr) == 1 && IN_MULTICAST(ntohl(mreq.imr_multiaddr.s_addr))) {
+        setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+    }
+
+    while (true) {
+        ssize_t                 n = recv(sock, buf, sizeof(buf), 0);
+        x6200_stream_header_t   h;
+
+        if (n < (ssize_t)sizeof(h)) {
+            continue;
+        }
+        memcpy(&h, buf, sizeof(h));
+
+        h.magic = le32toh(h.magic);
+        h.payload_len = le16toh(h.payload_len);
+        h.seq = le32toh(h.seq);
+        h.timestamp_us = le64toh(h.timestamp_us);
+        h.freq = le32toh(h.freq);
+
+        if (h.magic != X6200_STREAM_MAGIC || (ssize_t)(sizeof(h) + h.payload_len) != n) {
+            continue;
+        }
+        if (!first && h.seq != next_seq) {
+            lost += h.seq - next_seq;
+        }
+        first = false;
+        next_seq = h.seq + 1;
+
+        if (h.format == X6200_STREAM_SPECTRUM && !x6200_codec_decode(&codec, buf + sizeof(h), h.payload_len, db)) {
+            broken++;
+        }
+
+        if (h.seq % 30 == 0) {
+            double latency = now_sec(CLOCK_REALTIME) * 1000.0 - h.timestamp_us / 1000.0;
+
+            printf("seq %u, freq %u, format %u, %zd bytes, lost %u, not decoded %u, latency %.2f ms\n",
+                   h.seq, h.freq, h.format, n, lost, broken, latency);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    x6200_stream_config_t   stream = { .format = X6200_STREAM_RAW };
+    char                    *dests[X6200_STREAM_MAX_DESTS];
+    int                     dests_count = 0;
+    int                     opt;
+
+    while ((opt = getopt(argc, argv, "d:b:t:i:c:r:")) != -1) {
+        switch (opt) {
+            case 'd':
+                if (dests_count < X6200_STREAM_MAX_DESTS) {
+                    dests[dests_count++] = optarg;
+                }
+                break;
+
+            case 'b':
+                stream.batch = atoi(optarg);
+                break;
+
+            case 't':
+                stream.ttl = atoi(optarg);
+                break;
+
+            case 'i':
+                stream.iface = optarg;
+                break;
+
+            case 'c':
+                stream.format = X6200_STREAM_SPECTRUM;
+                stream.codec.step_db = atof(optarg);
+                break;
+
+            case 'r':
+                return subscribe(optarg);
+
+            default:
+                fprintf(stderr, "Usage: %s [-d host:port]... [-b batch] [-t ttl] [-i iface addr] [-c step dB] | -r host:port\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+
+    x6200_loop_config_t conf = {
+        .packet = packet,
+        .flow_timeout_ms = 500,
+    };
+
+    if (dests_count == 0) {
+        static char def[] = "239.62.0.1";
+
+        dests[dests_count++] = def;
+    }
+
+    if (!x6200_control_init())
+        return 1;
+
+    if (!x6200_flow_init())
+        return 1;
+
+    if (!x6200_stream_init(&stream))
+        return 1;
+
+    for (int i = 0; i < dests_count; i++) {
+        char        *host;
+        uint16_t    port;
+
+        if (!split_dest(dests[i], &host, &port) || !x6200_stream_dest_add(host, port))
+            return 1;
+    }
+
+    if (!x6200_loop_init(&conf))
+        return 1;
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    last_cpu = cpu_sec();
+    last_wall = now_sec(CLOCK_MONOTONIC);
+    x6200_loop_timer_add(STATS_MS, true, print_stats, NULL);
+
+    x6200_loop_run();
+    x6200_loop_close();
+    x6200_stream_close();
+}
@@ -0,0 +1,112 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+/*
+ * Antenna SWR sweep.
+ *
+ *   x6200_swr [-s start] [-e stop] [-t step] [-l max swr]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <aether_radio/x6200_control/control.h>
+#include <aether_radio/x6200_control/sweep.h>
+#include <aether_radio/x6200_control/low/flow.h>
+
+#define BAR_WIDTH 40
+
+static x6200_flow_t pack;
+
+int main(int argc, char *argv[]) {
+    x6200_sweep_config_t    conf = {
+        .vfo = X6200_VFO_A,
+        .start = 7000000,
+        .stop = 7200000,
+        .step = 10000,
+    };
+    int                     opt;
+
+    while ((opt = getopt(argc, argv, "s:e:t:l:")) != -1) {
+        switch (opt) {
+            case 's':
+                conf.start = atoi(optarg);
+                break;
+
+            case 'e':
+                conf.stop = atoi(optarg);
+                break;
+
+            case 't':
+                conf.step = atoi(optarg);
+                break;
+
+            case 'l':
+                conf.max_swr = atof(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-s start] [-e stop] [-t step] [-l max swr]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!x6200_control_init())
+        return 1;
+
+    if (!x6200_flow_init())
+        return 1;
+
+    /* Sweep when BASE is streaming */
+
+    while (!x6200_flow_read(&pack)) {
+        usleep(10000);
+    }
+
+    conf.vfo = (x6200_control_get(x6200_vi_vm) & 0xFF) ? X6200_VFO_B : X6200_VFO_A;
+
+    if (!x6200_sweep_start(&conf))
+        return 1;
+
+    x6200_sweep_state_t state;
+
+    do {
+        if (!x6200_flow_read(&pack)) {
+            usleep(5000);
+            continue;
+        }
+        state = x6200_sweep_process(&pack);
+    } while (state != X6200_SWEEP_DONE && state != X6200_SWEEP_FAILED);
+
+    x6200_sweep_result_t res;
+
+    if (!x6200_sweep_result(&res)) {
+        printf("No points\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < res.count; i++) {
+        const x6200_sweep_point_t   *p = &res.points[i];
+        int                         bar = (p->swr - 1.0f) * BAR_WIDTH / 3.0f;
+
+        printf("%9u  %5.2f  %4.1f W  %.*s\n", p->freq, p->swr, p->power,
+               bar < 0 ? 0 : bar > BAR_WIDTH ? BAR_WIDTH : bar, "########################################");
+    }
+
+    printf("Minimum %.2f at %u", res.points[res.min_index].swr, res.points[res.min_index].freq);
+
+    if (res.bw_low) {
+        printf(", 2:1 from %u to %u (%u Hz)", res.bw_low, res.bw_high, res.bw_high - res.bw_low);
+    }
+    printf("\n%s: %zu points in %.0f ms, %u TX packets\n",
+           state == X6200_SWEEP_DONE ? "Done" : "Stopped", res.count, res.elapsed_ms, res.packets);
+
+    return state != X6200_SWEEP_DONE;
+}
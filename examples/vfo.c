@@ -17,7 +17,7 @@
 static x6200_flow_t pack;
 
 int main() {
-    if (!x6200_control_init())
+    if (!x6200_control_init_start(5000))
         return 1;
 
     if (!x6200_gpio_init())
@@ -26,6 +26,9 @@ int main() {
     if (!x6200_flow_init())
         return 1;
 
+    if (!x6200_control_init_wait())
+        return 1;
+
     x6200_control_rxvol_set(20);
 
     x6200_control_vfo_mode_set(X6200_VFO_A, x6200_mode_usb_dig);
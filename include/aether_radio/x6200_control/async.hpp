@@ -0,0 +1,481 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "aether_radio/x6200_control/control.hpp"
+
+extern "C" {
+#include "aether_radio/x6200_control/loop.h"
+}
+
+/*
+ * Coroutines on the event loop. The executor owns x6200_loop, so awaiting tasks are resumed from
+ * its flow, flags and timer callbacks in the thread of executor::run(). Nothing is polled:
+ *
+ *   x6200::task<> ptt_check() {
+ *       x6200_control_ptt_set(true);
+ *
+ *       if (!co_await x6200::flag_change(x6200::flag::tx, 500)) {
+ *           printf("No TX\n");
+ *       }
+ *       ...
+ *   }
+ *
+ *   x6200::executor ex;
+ *   ex.spawn(ptt_check());
+ *   ex.run();                  // Until all spawned tasks are done
+ *
+ * Awaitables with timeout_ms give std::optional, empty on timeout. Call after
+ * x6200_control_init() and x6200_flow_init(), one executor per process.
+ */
+
+namespace aether_radio::x6200 {
+
+/* Bits of x6200_flow_flags_t for flag_change() */
+
+namespace flag {
+
+constexpr uint32_t resync = 1u << 0;
+constexpr uint32_t tx = 1u << 1;
+constexpr uint32_t atu_status = 1u << 2;
+constexpr uint32_t vext = 1u << 3;
+constexpr uint32_t charging = 1u << 4;
+constexpr uint32_t power_key = 1u << 11;
+constexpr uint32_t sql_mute = 1u << 12;
+constexpr uint32_t sql_fm_mute = 1u << 13;
+
+} // namespace flag
+
+static_assert(sizeof(x6200_flow_flags_t) == sizeof(uint32_t));
+
+inline uint32_t flag_bits(x6200_flow_flags_t flags) {
+    return std::bit_cast<uint32_t>(flags);
+}
+
+/* Lazy task, starts when awaited or spawned */
+
+template <typename T = void>
+class task;
+
+namespace detail {
+
+struct final_awaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+        std::coroutine_handle<> next = h.promise().continuation;
+
+        return next ? next : std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+};
+
+struct promise_base {
+    std::coroutine_handle<> continuation;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    final_awaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+};
+
+template <typename T>
+struct promise : promise_base {
+    std::optional<T> value;
+
+    task<T> get_return_object();
+    void return_value(T v) { value = std::move(v); }
+    T result() { return std::move(*value); }
+};
+
+template <>
+struct promise<void> : promise_base {
+    task<void> get_return_object();
+    void return_void() {}
+    void result() {}
+};
+
+} // namespace detail
+
+template <typename T>
+class task {
+public:
+    using promise_type = detail::promise<T>;
+
+    explicit task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+    task(task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+
+    ~task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    bool await_ready() const { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) {
+        handle_.promise().continuation = caller;
+        return handle_;
+    }
+
+    T await_resume() { return handle_.promise().result(); }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+task<T> promise<T>::get_return_object() {
+    return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object() {
+    return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+/* Executor */
+
+struct packet_wait;
+struct flags_wait;
+
+namespace detail {
+
+/* Suspended awaiter. Woken by an event or by its one-shot loop timer, whichever comes first */
+
+struct waiter {
+    std::coroutine_handle<>     handle;
+    int                         timer = -1;
+    bool                        timed_out = false;
+
+    void arm(uint32_t timeout_ms, x6200_loop_timer_cb_t cb) {
+        if (timeout_ms) {
+            timer = x6200_loop_timer_add(timeout_ms, false, cb, this);
+        }
+    }
+
+    void disarm() {
+        if (timer >= 0) {
+            x6200_loop_timer_remove(timer);
+            timer = -1;
+        }
+    }
+};
+
+} // namespace detail
+
+class executor {
+public:
+    explicit executor(uint32_t flow_timeout_ms = 0) {
+        x6200_loop_config_t conf = {};
+
+        conf.packet = on_packet;
+        conf.flags = on_flags;
+        conf.flow_timeout_ms = flow_timeout_ms;
+
+        current_ = this;
+        ok_ = x6200_loop_init(&conf);
+    }
+
+    ~executor() {
+        for (std::coroutine_handle<> h : tasks_) {
+            h.destroy();
+        }
+        x6200_loop_close();
+        current_ = nullptr;
+    }
+
+    executor(const executor &) = delete;
+    executor &operator=(const executor &) = delete;
+
+    explicit operator bool() const { return ok_; }
+
+    static executor &current() { return *current_; }
+
+    /* Task starts at once and runs until its first suspension */
+
+    void spawn(task<void> t) { drive(std::move(t)); }
+
+    void run() {
+        if (!tasks_.empty()) {
+            x6200_loop_run();
+        }
+    }
+
+    void stop() { x6200_loop_stop(); }
+
+    size_t active() const { return tasks_.size(); }
+
+private:
+    friend struct packet_wait;
+    friend struct flags_wait;
+
+    struct detached {
+        struct promise_type {
+            detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    struct self_handle {
+        bool await_ready() { return false; }
+        bool await_suspend(std::coroutine_handle<> h) { handle = h; return false; }
+        std::coroutine_handle<> await_resume() { return handle; }
+
+        std::coroutine_handle<> handle;
+    };
+
+    detached drive(task<void> t) {
+        std::coroutine_handle<> self = co_await self_handle{};
+
+        tasks_.push_back(self);
+        co_await t;
+        std::erase(tasks_, self);
+
+        if (tasks_.empty()) {
+            x6200_loop_stop();
+        }
+    }
+
+    static void on_packet(const x6200_flow_t *pack, void *user);
+    static void on_flags(x6200_flow_flags_t prev, x6200_flow_flags_t flags, void *user);
+
+    static inline executor                  *current_ = nullptr;
+
+    bool                                    ok_;
+    std::vector<std::coroutine_handle<>>    tasks_;
+    std::vector<packet_wait *>              packet_waiters_;
+    std::vector<flags_wait *>               flags_waiters_;
+};
+
+/* Awaiters */
+
+struct packet_wait : detail::waiter {
+    x6200_flow_t    pack;
+    uint32_t        timeout_ms;
+    bool            discard;        /* Packet must start after the suspension */
+    uint8_t         skip;           /* Packets to pass before wake */
+
+    packet_wait(uint32_t timeout, bool discard_input) :
+        timeout_ms(timeout), discard(discard_input), skip(discard_input ? 1 : 0) {}
+    packet_wait(const packet_wait &) = delete;
+
+    ~packet_wait() {
+        if (handle) {
+            std::erase(executor::current().packet_waiters_, this);
+            disarm();
+        }
+    }
+
+    bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        if (discard) {
+            x6200_flow_discard();
+        }
+        handle = h;
+        executor::current().packet_waiters_.push_back(this);
+        arm(timeout_ms, on_timeout);
+    }
+
+    void wake(const x6200_flow_t *p) {
+        pack = *p;
+        disarm();
+        std::exchange(handle, nullptr).resume();
+    }
+
+    static void on_timeout(void *user) {
+        packet_wait *w = static_cast<packet_wait *>(user);
+
+        std::erase(executor::current().packet_waiters_, w);
+        w->timer = -1;
+        w->timed_out = true;
+        std::exchange(w->handle, nullptr).resume();
+    }
+};
+
+struct flags_wait : detail::waiter {
+    x6200_flow_flags_t  flags;
+    uint32_t            mask;
+    uint32_t            timeout_ms;
+
+    flags_wait(uint32_t bits, uint32_t timeout) : mask(bits), timeout_ms(timeout) {}
+    flags_wait(const flags_wait &) = delete;
+
+    ~flags_wait() {
+        if (handle) {
+            std::erase(executor::current().flags_waiters_, this);
+            disarm();
+        }
+    }
+
+    bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        handle = h;
+        executor::current().flags_waiters_.push_back(this);
+        arm(timeout_ms, on_timeout);
+    }
+
+    void wake(x6200_flow_flags_t f) {
+        flags = f;
+        disarm();
+        std::exchange(handle, nullptr).resume();
+    }
+
+    static void on_timeout(void *user) {
+        flags_wait *w = static_cast<flags_wait *>(user);
+
+        std::erase(executor::current().flags_waiters_, w);
+        w->timer = -1;
+        w->timed_out = true;
+        std::exchange(w->handle, nullptr).resume();
+    }
+};
+
+/* Waiters are taken out before resume, so a task awaiting again waits for the next event */
+
+inline void executor::on_packet(const x6200_flow_t *pack, void *) {
+    std::vector<packet_wait *>  waiters = std::exchange(current_->packet_waiters_, {});
+    std::vector<packet_wait *>  ready;
+
+    for (packet_wait *w : waiters) {
+        if (w->skip > 0) {
+            w->skip--;
+            current_->packet_waiters_.push_back(w);
+        } else {
+            ready.push_back(w);
+        }
+    }
+    for (packet_wait *w : ready) {
+        w->wake(pack);
+    }
+}
+
+inline void executor::on_flags(x6200_flow_flags_t prev, x6200_flow_flags_t flags, void *) {
+    uint32_t                    changed = flag_bits(prev) ^ flag_bits(flags);
+    std::vector<flags_wait *>   waiters = std::exchange(current_->flags_waiters_, {});
+    std::vector<flags_wait *>   ready;
+
+    for (flags_wait *w : waiters) {
+        (changed & w->mask ? ready : current_->flags_waiters_).push_back(w);
+    }
+    for (flags_wait *w : ready) {
+        w->wake(flags);
+    }
+}
+
+namespace detail {
+
+struct next_packet_t : packet_wait {
+    using packet_wait::packet_wait;
+    x6200_flow_t await_resume() { return pack; }
+};
+
+struct next_packet_timeout_t : packet_wait {
+    using packet_wait::packet_wait;
+    std::optional<x6200_flow_t> await_resume() { return timed_out ? std::nullopt : std::optional(pack); }
+};
+
+struct flag_change_t : flags_wait {
+    using flags_wait::flags_wait;
+    x6200_flow_flags_t await_resume() { return flags; }
+};
+
+struct flag_change_timeout_t : flags_wait {
+    using flags_wait::flags_wait;
+    std::optional<x6200_flow_flags_t> await_resume() { return timed_out ? std::nullopt : std::optional(flags); }
+};
+
+struct sleep_t : waiter {
+    uint32_t ms;
+
+    explicit sleep_t(uint32_t period) : ms(period) {}
+    sleep_t(const sleep_t &) = delete;
+
+    ~sleep_t() { disarm(); }
+
+    bool await_ready() const { return ms == 0; }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+        handle = h;
+        arm(ms, on_timeout);
+        return timer >= 0;
+    }
+
+    void await_resume() {}
+
+    static void on_timeout(void *user) {
+        sleep_t *w = static_cast<sleep_t *>(user);
+
+        w->timer = -1;
+        w->handle.resume();
+    }
+};
+
+} // namespace detail
+
+/* Next valid packet */
+
+inline detail::next_packet_t next_packet() {
+    return detail::next_packet_t(0, false);
+}
+
+inline detail::next_packet_timeout_t next_packet(uint32_t timeout_ms) {
+    return detail::next_packet_timeout_t(timeout_ms, false);
+}
+
+/* Flags of mask (x6200::flag) differ from the previous packet. Gives the new flags */
+
+inline detail::flag_change_t flag_change(uint32_t mask) {
+    return detail::flag_change_t(mask, 0);
+}
+
+inline detail::flag_change_timeout_t flag_change(uint32_t mask, uint32_t timeout_ms) {
+    return detail::flag_change_timeout_t(mask, timeout_ms);
+}
+
+/*
+ * Likely the first packet reflecting register writes made before the await. BASE doesn't report
+ * when a write is applied, so this is a heuristic: pending serial input is discarded, like after
+ * a retune in scan.c, and one more packet is skipped, as the first one may be measured before.
+ */
+
+inline detail::next_packet_t command_committed() {
+    return detail::next_packet_t(0, true);
+}
+
+inline detail::next_packet_timeout_t command_committed(uint32_t timeout_ms) {
+    return detail::next_packet_timeout_t(timeout_ms, true);
+}
+
+inline detail::sleep_t sleep(uint32_t ms) {
+    return detail::sleep_t(ms);
+}
+
+} // namespace aether_radio::x6200
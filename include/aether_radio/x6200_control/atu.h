@@ -0,0 +1,73 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "aether_radio/x6200_control/control.h"
+#include "aether_radio/x6200_control/low/flow.h"
+
+/*
+ * ATU engine with tuning memory. A tune cycle is x6200_control_atu_tune(true), TX rise and
+ * fall in flow packets, then atu_params of the packet is stored for the frequency segment of
+ * the foreground VFO. Application passes every packet to x6200_atu_process().
+ *
+ * When the foreground frequency moves to another segment with a stored network and the ATU is
+ * enabled, the network is written to x6200_atu_network at once, without carrier.
+ *
+ * Memory file is text, one "segment_start_hz params_hex" per line, written on every change.
+ */
+
+typedef enum {
+    X6200_ATU_IDLE = 0,
+    X6200_ATU_STARTING,         /* Tune sent, waiting for TX */
+    X6200_ATU_TUNING,           /* Carrier on, waiting for TX to fall */
+} x6200_atu_state_t;
+
+typedef enum {
+    X6200_ATU_NONE = 0,
+    X6200_ATU_STARTED,          /* Tune cycle is running */
+    X6200_ATU_RESTORED,         /* Network from memory, no carrier */
+    X6200_ATU_TUNED,
+    X6200_ATU_FAILED,           /* Timeout, abort or no network from BASE */
+} x6200_atu_result_t;
+
+typedef struct {
+    const char  *path;              /* Memory file, NULL - not persistent */
+    uint32_t    segment_hz;         /* 0 - 25 kHz */
+    uint16_t    start_timeout_ms;   /* TX must rise, 0 - 1000 */
+    uint16_t    tune_timeout_ms;    /* TX must fall, 0 - 10000 */
+    bool        auto_restore;       /* Restore on segment change */
+} x6200_atu_config_t;
+
+typedef struct {
+    uint32_t    tunes;
+    uint32_t    restores;
+    uint32_t    failures;
+    float       last_tune_ms;       /* Tune sent to TX fall */
+    size_t      entries;
+} x6200_atu_stats_t;
+
+AETHER_X6200CTRL_API bool x6200_atu_init(const x6200_atu_config_t *conf);     /* Loads memory file */
+AETHER_X6200CTRL_API void x6200_atu_close();
+
+/* Foreground VFO frequency. Stored network is restored unless force, otherwise tune cycle starts */
+
+AETHER_X6200CTRL_API x6200_atu_result_t x6200_atu_start(bool force);
+AETHER_X6200CTRL_API void x6200_atu_abort();
+
+AETHER_X6200CTRL_API x6200_atu_state_t x6200_atu_process(const x6200_flow_t *pack);
+AETHER_X6200CTRL_API x6200_atu_state_t x6200_atu_state();
+AETHER_X6200CTRL_API x6200_atu_result_t x6200_atu_result();        /* Of last tune or restore */
+
+AETHER_X6200CTRL_API bool x6200_atu_lookup(uint32_t freq, uint32_t *params);
+AETHER_X6200CTRL_API void x6200_atu_forget(uint32_t freq);         /* Segment of freq, 0 - all */
+AETHER_X6200CTRL_API void x6200_atu_stats(x6200_atu_stats_t *stats);
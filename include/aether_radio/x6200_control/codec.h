@@ -0,0 +1,55 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "aether_radio/x6200_control/api.h"
+#include "aether_radio/x6200_control/low/flow.h"
+
+/*
+ * Spectrum line codec for low bandwidth links. Flow samples are 256 complex IQ values, they are
+ * turned into a 256 bin power spectrum in dB, quantized with a fixed step and predicted from the
+ * previous line (or the lower bin, whichever is better for a block of 16 bins). Residuals are
+ * Rice coded with a parameter per block.
+ *
+ * Every keyframe line is coded alone, so a decoder which lost lines recovers at the next one.
+ * Encoder and decoder keep state, one x6200_codec_t per direction and stream.
+ */
+
+#define X6200_CODEC_BINS        256
+#define X6200_CODEC_MAX_SIZE    1536        /* Worst case of one encoded line */
+
+typedef struct {
+    float       step_db;        /* Quantization step, 0.05 - 12.0, 0 - 1.0. Error is within step / 2 */
+    uint8_t     keyframe;       /* Line coded alone every N lines, 0 - 16 */
+} x6200_codec_config_t;
+
+typedef struct {
+    x6200_codec_config_t    conf;
+    int16_t                 prev[X6200_CODEC_BINS];
+    uint8_t                 line;
+    uint8_t                 step;
+    uint8_t                 since_key;
+    bool                    valid;
+} x6200_codec_t;
+
+AETHER_X6200CTRL_API void x6200_codec_init(x6200_codec_t *codec, const x6200_codec_config_t *conf);
+
+/* Hann windowed power spectrum of flow samples, lowest frequency first */
+
+AETHER_X6200CTRL_API void x6200_codec_spectrum(const x6200_flow_t *pack, float db[X6200_CODEC_BINS]);
+
+AETHER_X6200CTRL_API size_t x6200_codec_encode(x6200_codec_t *codec, const float db[X6200_CODEC_BINS], uint8_t *out);   /* Bytes written */
+
+/* False if line is broken or refers to a line the decoder has not seen, until next keyframe */
+
+AETHER_X6200CTRL_API bool x6200_codec_decode(x6200_codec_t *codec, const uint8_t *in, size_t len, float db[X6200_CODEC_BINS]);
@@ -17,6 +17,17 @@ typedef enum {
     X6200_VFO_B
 } x6200_vfo_t;
 
+/* State snapshot */
+
+#define X6200_SNAPSHOT_SIZE 224
+
+typedef struct {
+    uint8_t data[X6200_SNAPSHOT_SIZE];
+} x6200_snapshot_t;
+
+AETHER_X6200CTRL_API void x6200_control_snapshot(x6200_snapshot_t *snap);
+AETHER_X6200CTRL_API bool x6200_control_restore(const x6200_snapshot_t *snap);   /* Only differing registers, one transfer */
+
 /* VFO Settings */
 
 AETHER_X6200CTRL_API void x6200_control_vfo_set(x6200_vfo_t vfo);
@@ -49,11 +60,26 @@ AETHER_X6200CTRL_API void x6200_control_rx_filter_set(int16_t low, int16_t high)
 AETHER_X6200CTRL_API void x6200_control_rx_filter_set_low(int16_t low);
 AETHER_X6200CTRL_API void x6200_control_rx_filter_set_high(int16_t high);
 
-// AETHER_X6200CTRL_API void x6200_control_ssb_filter_set_set(uint16_t low, uint16_t high);
-// AETHER_X6200CTRL_API void x6200_control_cw_filter_set_set(uint16_t bw);
-// AETHER_X6200CTRL_API void x6200_control_am_filter_set_set(uint16_t bw);
-// AETHER_X6200CTRL_API void x6200_control_nfm_filter_set_set(uint16_t bw);
-// AETHER_X6200CTRL_API void x6200_control_wfm_filter_set_set(uint16_t bw);
+/*
+ * Filter bank. Every group keeps its own low/high edges in the per-mode register
+ * (x6200_filter_ssb ... x6200_filter_wfm). Changing mode of the active VFO writes the mode
+ * together with its filter in one I2C transfer.
+ */
+
+typedef enum {
+    X6200_FILTER_SSB = 0,   /* LSB, USB and digital variants */
+    X6200_FILTER_CW,        /* CW, CWR */
+    X6200_FILTER_AM,        /* AM, SAM */
+    X6200_FILTER_NFM,
+    X6200_FILTER_WFM,
+
+    X6200_FILTER_LAST
+} x6200_filter_group_t;
+
+AETHER_X6200CTRL_API x6200_filter_group_t x6200_control_filter_group(x6200_mode_t mode);
+AETHER_X6200CTRL_API void x6200_control_filter_bank_set(x6200_filter_group_t group, int16_t low, int16_t high);
+AETHER_X6200CTRL_API void x6200_control_filter_bank_get(x6200_filter_group_t group, int16_t *low, int16_t *high);
+AETHER_X6200CTRL_API uint32_t x6200_control_filter_bank_packed(x6200_filter_group_t group);   /* low << 16 | high */
 
 /* Operation */
 
@@ -138,6 +164,7 @@ AETHER_X6200CTRL_API void x6200_control_rx_eq_p2_set(int8_t level);
 AETHER_X6200CTRL_API void x6200_control_rx_eq_p3_set(int8_t level);
 AETHER_X6200CTRL_API void x6200_control_rx_eq_p4_set(int8_t level);
 AETHER_X6200CTRL_API void x6200_control_rx_eq_p5_set(int8_t level);
+AETHER_X6200CTRL_API void x6200_control_rx_eq_apply(bool on, const int8_t bands[5]);   /* All bands in one write */
 
 /* RX EQ WFM */
 AETHER_X6200CTRL_API void x6200_control_rx_eq_wfm_set(bool on);
@@ -146,6 +173,7 @@ AETHER_X6200CTRL_API void x6200_control_rx_eq_wfm_p2_set(int8_t level);
 AETHER_X6200CTRL_API void x6200_control_rx_eq_wfm_p3_set(int8_t level);
 AETHER_X6200CTRL_API void x6200_control_rx_eq_wfm_p4_set(int8_t level);
 AETHER_X6200CTRL_API void x6200_control_rx_eq_wfm_p5_set(int8_t level);
+AETHER_X6200CTRL_API void x6200_control_rx_eq_wfm_apply(bool on, const int8_t bands[5]);   /* All bands in one write */
 
 /* MIC EQ */
 AETHER_X6200CTRL_API void x6200_control_mic_eq_set(bool on);
@@ -154,3 +182,4 @@ AETHER_X6200CTRL_API void x6200_control_mic_eq_p2_set(int8_t level);
 AETHER_X6200CTRL_API void x6200_control_mic_eq_p3_set(int8_t level);
 AETHER_X6200CTRL_API void x6200_control_mic_eq_p4_set(int8_t level);
 AETHER_X6200CTRL_API void x6200_control_mic_eq_p5_set(int8_t level);
+AETHER_X6200CTRL_API void x6200_control_mic_eq_apply(bool on, const int8_t bands[5]);   /* All bands in one write */
@@ -0,0 +1,371 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#pragma once
+
+#if __cplusplus < 202002L
+#error "control.hpp needs C++20"
+#endif
+
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+
+extern "C" {
+#include "aether_radio/x6200_control/control.h"
+#include "aether_radio/x6200_control/low/control.h"
+#include "aether_radio/x6200_control/low/flow.h"
+#include "aether_radio/x6200_control/low/gpio.h"
+}
+
+/*
+ * Header-only C++20 layer. Packed registers are described by reg_field types, so masks and
+ * shifts are known at compile time:
+ *
+ *   x6200::update<x6200::fields::key_speed, x6200::fields::key_mode>(25, x6200::key_mode::auto_left);
+ *
+ * Any number of fields of one register is composed into a single mirror read and a single
+ * register write. Fields bypass the C setters, so settings with side state (VFO, mode, filters,
+ * PTT and other process bits) are left to the C API.
+ */
+
+namespace aether_radio::x6200 {
+
+/* Typed enums */
+
+enum class vfo : uint8_t {
+    a = X6200_VFO_A,
+    b = X6200_VFO_B,
+};
+
+enum class mode : uint8_t {
+    lsb = x6200_mode_lsb,
+    lsb_dig = x6200_mode_lsb_dig,
+    usb = x6200_mode_usb,
+    usb_dig = x6200_mode_usb_dig,
+    cw = x6200_mode_cw,
+    cwr = x6200_mode_cwr,
+    am = x6200_mode_am,
+    sam = x6200_mode_sam,
+    nfm = x6200_mode_nfm,
+    wfm = x6200_mode_wfm,
+};
+
+enum class agc : uint8_t {
+    off = x6200_agc_off,
+    slow = x6200_agc_slow,
+    fast = x6200_agc_fast,
+    autom = x6200_agc_auto,
+};
+
+enum class key_mode : uint8_t {
+    manual = x6200_key_manual,
+    auto_left = x6200_key_auto_left,
+    auto_right = x6200_key_auto_right,
+};
+
+enum class iambic_mode : uint8_t {
+    a = x6200_iambic_a,
+    b = x6200_iambic_b,
+};
+
+enum class mic : uint8_t {
+    builtin = x6200_mic_builtin,
+    handle = x6200_mic_handle,
+    autom = x6200_mic_auto,
+};
+
+enum class comp_level : uint8_t {
+    off = x6200_comp_off,
+    r1_2 = x6200_comp_1_2,
+    r1_4 = x6200_comp_1_4,
+    r1_8 = x6200_comp_1_8,
+};
+
+enum class dnf_mode : uint8_t {
+    off = x6200_dnf_off,
+    manual = x6200_dnf_manual,
+    autom = x6200_dnf_auto,
+};
+
+/* Field of a packed register. Signed values are sign extended on decode */
+
+template <x6200_cmd_enum_t Reg, unsigned Shift, unsigned Width, typename T = uint32_t>
+struct reg_field {
+    static_assert(Width > 0 && Shift + Width <= 32, "Field out of register");
+
+    using value_type = T;
+
+    static constexpr x6200_cmd_enum_t   reg = Reg;
+    static constexpr unsigned           shift = Shift;
+    static constexpr unsigned           width = Width;
+    static constexpr uint32_t           max = Width == 32 ? ~0u : (1u << Width) - 1;
+    static constexpr uint32_t           mask = max << Shift;
+
+    static constexpr uint32_t encode(T value) {
+        return (static_cast<uint32_t>(value) & max) << Shift;
+    }
+
+    static constexpr T decode(uint32_t raw) {
+        uint32_t value = (raw & mask) >> Shift;
+
+        if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            if (value & (1u << (Width - 1))) {
+                value |= ~max;
+            }
+            return static_cast<T>(static_cast<int32_t>(value));
+        } else {
+            return static_cast<T>(value);
+        }
+    }
+};
+
+template <typename F>
+concept register_field = requires(typename F::value_type value, uint32_t raw) {
+    { F::reg } -> std::convertible_to<x6200_cmd_enum_t>;
+    { F::mask } -> std::convertible_to<uint32_t>;
+    { F::encode(value) } -> std::same_as<uint32_t>;
+    { F::decode(raw) } -> std::same_as<typename F::value_type>;
+};
+
+/* Fields, the same layout as setters of control.c */
+
+namespace fields {
+
+using rfg           = reg_field<x6200_rfg_txpwr, 0, 8, uint8_t>;
+using txpwr         = reg_field<x6200_rfg_txpwr, 8, 8, uint8_t>;           /* 0.1 W */
+
+using split         = reg_field<x6200_sple_atue_trx, 1, 1, bool>;
+using voice_rec     = reg_field<x6200_sple_atue_trx, 3, 1, bool>;
+using atu           = reg_field<x6200_sple_atue_trx, 12, 1, bool>;
+
+using vm            = reg_field<x6200_vi_vm, 16, 1, bool>;
+
+using linein        = reg_field<x6200_ling_loutg_imicg_hmicg, 0, 8, uint8_t>;
+using lineout       = reg_field<x6200_ling_loutg_imicg_hmicg, 8, 8, uint8_t>;
+using imic          = reg_field<x6200_ling_loutg_imicg_hmicg, 16, 8, uint8_t>;
+using hmic          = reg_field<x6200_ling_loutg_imicg_hmicg, 24, 8, uint8_t>;
+
+using mic_sel       = reg_field<x6200_micsel_pttmode_chge_spmode_auxiqgen_sqlthr, 0, 2, mic>;
+using charger       = reg_field<x6200_micsel_pttmode_chge_spmode_auxiqgen_sqlthr, 4, 1, bool>;
+using spmode        = reg_field<x6200_micsel_pttmode_chge_spmode_auxiqgen_sqlthr, 5, 1, bool>;
+using iqout         = reg_field<x6200_micsel_pttmode_chge_spmode_auxiqgen_sqlthr, 6, 1, bool>;
+using sql           = reg_field<x6200_micsel_pttmode_chge_spmode_auxiqgen_sqlthr, 8, 8, uint8_t>;
+using sql_fm        = reg_field<x6200_micsel_pttmode_chge_spmode_auxiqgen_sqlthr, 16, 8, uint8_t>;
+using sql_enable    = reg_field<x6200_micsel_pttmode_chge_spmode_auxiqgen_sqlthr, 24, 1, bool>;
+
+using vox_gain      = reg_field<x6200_voxg_voxag_voxdly_voxe, 0, 7, uint8_t>;
+using vox_ag        = reg_field<x6200_voxg_voxag_voxdly_voxe, 7, 7, uint8_t>;
+using vox_delay     = reg_field<x6200_voxg_voxag_voxdly_voxe, 14, 12, uint16_t>;
+using vox           = reg_field<x6200_voxg_voxag_voxdly_voxe, 26, 1, bool>;
+
+using nr_level      = reg_field<x6200_nrthr_nbw_nbthr_nre_nbe, 0, 8, uint8_t>;
+using nb_width      = reg_field<x6200_nrthr_nbw_nbthr_nre_nbe, 8, 8, uint8_t>;
+using nb_level      = reg_field<x6200_nrthr_nbw_nbthr_nre_nbe, 16, 8, uint8_t>;
+using nr            = reg_field<x6200_nrthr_nbw_nbthr_nre_nbe, 24, 1, bool>;
+using nb            = reg_field<x6200_nrthr_nbw_nbthr_nre_nbe, 25, 1, bool>;
+
+using dnf_center    = reg_field<x6200_dnfcnt_dnfwidth_dnfe, 0, 12, uint16_t>;
+using dnf_width     = reg_field<x6200_dnfcnt_dnfwidth_dnfe, 12, 12, uint16_t>;
+using dnf           = reg_field<x6200_dnfcnt_dnfwidth_dnfe, 24, 2, dnf_mode>;
+
+using comp_level    = reg_field<x6200_cmplevel_cmpe, 0, 4, x6200::comp_level>;
+using comp          = reg_field<x6200_cmplevel_cmpe, 4, 1, bool>;
+
+using agc_knee      = reg_field<x6200_agcknee_agcslope_agchang, 0, 8, int8_t>;
+using agc_slope     = reg_field<x6200_agcknee_agcslope_agchang, 8, 4, uint8_t>;
+using agc_hang      = reg_field<x6200_agcknee_agcslope_agchang, 12, 1, bool>;
+using agc_time      = reg_field<x6200_agctime, 0, 16, uint16_t>;
+
+using monitor_level = reg_field<x6200_monilevel_fftdec_fftzoomcw, 0, 8, uint8_t>;
+using fft_dec       = reg_field<x6200_monilevel_fftdec_fftzoomcw, 8, 4, uint8_t>;
+using fft_zoom_cw   = reg_field<x6200_monilevel_fftdec_fftzoomcw, 12, 4, uint8_t>;
+
+using key_speed     = reg_field<x6200_ks_km_kimb_cwtone_cwvol_cwtrain, 0, 8, uint8_t>;
+using key_mode      = reg_field<x6200_ks_km_kimb_cwtone_cwvol_cwtrain, 8, 2, x6200::key_mode>;
+using iambic_mode   = reg_field<x6200_ks_km_kimb_cwtone_cwvol_cwtrain, 10, 2, x6200::iambic_mode>;
+using key_tone      = reg_field<x6200_ks_km_kimb_cwtone_cwvol_cwtrain, 12, 11, uint16_t>;
+using key_vol       = reg_field<x6200_ks_km_kimb_cwtone_cwvol_cwtrain, 23, 6, uint8_t>;
+using key_train     = reg_field<x6200_ks_km_kimb_cwtone_cwvol_cwtrain, 29, 1, bool>;
+
+using qsk_time      = reg_field<x6200_qsktime_kr, 0, 16, uint16_t>;
+using key_ratio     = reg_field<x6200_qsktime_kr, 16, 16, uint16_t>;       /* 0.1 */
+
+using bias_drive    = reg_field<x6200_biasdrive_biasfinal, 0, 16, uint16_t>;
+using bias_final    = reg_field<x6200_biasdrive_biasfinal, 16, 16, uint16_t>;
+
+/* EQ registers: 5 bands x 5 bits, enable at bit 25 */
+
+template <x6200_cmd_enum_t Reg>
+struct eq {
+    using p1 = reg_field<Reg, 0, 5, int8_t>;
+    using p2 = reg_field<Reg, 5, 5, int8_t>;
+    using p3 = reg_field<Reg, 10, 5, int8_t>;
+    using p4 = reg_field<Reg, 15, 5, int8_t>;
+    using p5 = reg_field<Reg, 20, 5, int8_t>;
+    using on = reg_field<Reg, 25, 1, bool>;
+};
+
+using rx_eq         = eq<x6200_rxeq>;
+using rx_eq_wfm     = eq<x6200_rxeqwfm>;
+using mic_eq        = eq<x6200_miceq>;
+
+static_assert(key_tone::mask == 0x7FF << 12);
+static_assert(vox_delay::mask == 0xFFF << 14);
+static_assert(agc_knee::decode(agc_knee::encode(-20)) == -20);
+
+} // namespace fields
+
+/* Compose fields of one register at compile time */
+
+template <register_field F, register_field... Rest>
+struct field_set {
+    static constexpr x6200_cmd_enum_t   reg = F::reg;
+    static constexpr uint32_t           mask = (F::mask | ... | Rest::mask);
+
+    static_assert(((Rest::reg == F::reg) && ...), "Fields of different registers");
+    static_assert((uint64_t{F::mask} + ... + Rest::mask) == mask, "Overlapping fields");
+};
+
+template <register_field... F>
+constexpr uint32_t compose(uint32_t raw, typename F::value_type... values) {
+    return (raw & ~field_set<F...>::mask) | (F::encode(values) | ...);
+}
+
+/* Entry for x6200::batch(), from the register mirror */
+
+template <register_field... F>
+inline x6200_cmd_arg_t cmd(typename F::value_type... values) {
+    constexpr x6200_cmd_enum_t reg = field_set<F...>::reg;
+
+    return { reg, compose<F...>(x6200_control_get(reg), values...) };
+}
+
+/* Read-modify-write of the mirror, one register write */
+
+template <register_field... F>
+inline bool update(typename F::value_type... values) {
+    constexpr x6200_cmd_enum_t reg = field_set<F...>::reg;
+
+    return x6200_control_cmd(reg, compose<F...>(x6200_control_get(reg), values...));
+}
+
+template <register_field F>
+inline typename F::value_type get() {
+    return F::decode(x6200_control_get(F::reg));
+}
+
+/* Several registers in one transfer */
+
+template <std::same_as<x6200_cmd_arg_t>... C>
+inline bool batch(const C &... cmds) {
+    const x6200_cmd_arg_t list[] = { cmds... };
+
+    return x6200_control_cmd_batch(list, sizeof...(C));
+}
+
+/* VFO */
+
+inline void vfo_set(vfo v) {
+    x6200_control_vfo_set(static_cast<x6200_vfo_t>(v));
+}
+
+inline void vfo_freq_set(vfo v, uint32_t freq) {
+    x6200_control_vfo_freq_set(static_cast<x6200_vfo_t>(v), freq);
+}
+
+inline void vfo_mode_set(vfo v, mode m) {
+    x6200_control_vfo_mode_set(static_cast<x6200_vfo_t>(v), static_cast<x6200_mode_t>(m));
+}
+
+inline void vfo_agc_set(vfo v, agc a) {
+    x6200_control_vfo_agc_set(static_cast<x6200_vfo_t>(v), static_cast<x6200_agc_t>(a));
+}
+
+inline uint32_t vfo_freq(vfo v) {
+    return x6200_control_get(v == vfo::a ? x6200_vfoa_freq : x6200_vfob_freq);
+}
+
+inline mode vfo_mode(vfo v) {
+    return static_cast<mode>(x6200_control_get(v == vfo::a ? x6200_vfoa_mode : x6200_vfob_mode));
+}
+
+/* RAII handles. No exceptions, check with operator bool */
+
+class control {
+public:
+    explicit control(uint32_t timeout_ms = 0, const char *cache = nullptr) {
+        cache_ = cache && x6200_control_cache_open(cache);
+        ok_ = x6200_control_init_timeout(timeout_ms);
+    }
+
+    ~control() {
+        if (cache_) {
+            x6200_control_cache_close();
+        }
+    }
+
+    control(const control &) = delete;
+    control &operator=(const control &) = delete;
+
+    explicit operator bool() const { return ok_; }
+
+    void idle() { x6200_control_idle(); }
+    bool sync(bool repair, x6200_control_sync_t *result = nullptr) { return x6200_control_sync(repair, result); }
+
+private:
+    bool ok_;
+    bool cache_;
+};
+
+class flow {
+public:
+    flow() : ok_(x6200_flow_init()) {}
+
+    ~flow() {
+        if (ok_) {
+            x6200_flow_close();
+        }
+    }
+
+    flow(const flow &) = delete;
+    flow &operator=(const flow &) = delete;
+
+    explicit operator bool() const { return ok_; }
+
+    bool read(x6200_flow_t &pack) { return x6200_flow_read(&pack); }
+    bool restart() { return x6200_flow_restart(); }
+    void discard() { x6200_flow_discard(); }
+    int fd() const { return x6200_flow_fd(); }
+
+private:
+    bool ok_;
+};
+
+/* Lines are requested for the process lifetime, nothing to release */
+
+class gpio {
+public:
+    gpio() : ok_(x6200_gpio_init()) {}
+
+    gpio(const gpio &) = delete;
+    gpio &operator=(const gpio &) = delete;
+
+    explicit operator bool() const { return ok_; }
+
+    void set(int pin, bool value) { x6200_gpio_set(pin, value); }
+    bool set_many(uint32_t mask, uint32_t values) { return x6200_gpio_set_many(mask, values); }
+
+private:
+    bool ok_;
+};
+
+} // namespace aether_radio::x6200
+
+namespace x6200 = aether_radio::x6200;
@@ -0,0 +1,60 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "aether_radio/x6200_control/api.h"
+
+/*
+ * Software CW keyer on the morse key GPIO. Elements are keyed by own thread, every edge is
+ * slept to an absolute deadline, so timing errors do not accumulate. Lateness of every edge
+ * against its deadline is measured as jitter.
+ *
+ * PARIS timing: dot is 1200 / wpm ms, dash is ratio dots, element space 1 dot, character
+ * space 3 dots, word space 7 dots. Weight 50 is neutral, higher makes marks longer and spaces
+ * shorter by the same time, so the speed does not change.
+ */
+
+typedef enum {
+    X6200_KEYER_DOT = 0,
+    X6200_KEYER_DASH,
+    X6200_KEYER_CHAR_SPACE,     /* Added after last element of character */
+    X6200_KEYER_WORD_SPACE,     /* Added after character space */
+} x6200_keyer_element_t;
+
+typedef struct {
+    uint8_t     wpm;            /* 0 - from x6200_control_key_speed_set() */
+    uint8_t     weight;         /* 25 - 75, 50 - neutral, 0 - default 50 */
+    float       ratio;          /* Dash to dot, 0 - from x6200_control_key_ratio_set() */
+    int         priority;       /* SCHED_FIFO priority, 0 - normal thread */
+} x6200_keyer_config_t;
+
+typedef struct {
+    uint32_t    edges;
+    float       jitter_last_us;
+    float       jitter_avg_us;
+    float       jitter_max_us;
+} x6200_keyer_stats_t;
+
+AETHER_X6200CTRL_API bool x6200_keyer_start(const x6200_keyer_config_t *conf);
+AETHER_X6200CTRL_API void x6200_keyer_stop();
+AETHER_X6200CTRL_API void x6200_keyer_config_set(const x6200_keyer_config_t *conf);     /* Applied from next element */
+
+/* Append to queue. False if queue is full, then nothing is added */
+
+AETHER_X6200CTRL_API bool x6200_keyer_send_text(const char *text);
+AETHER_X6200CTRL_API bool x6200_keyer_send_elements(const x6200_keyer_element_t *elements, size_t count);
+
+AETHER_X6200CTRL_API void x6200_keyer_abort();          /* Drop queue, keyer thread keys up within a slice (5 ms) */
+AETHER_X6200CTRL_API bool x6200_keyer_busy();
+AETHER_X6200CTRL_API void x6200_keyer_stats(x6200_keyer_stats_t *stats);
+AETHER_X6200CTRL_API void x6200_keyer_stats_reset();
@@ -0,0 +1,57 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "aether_radio/x6200_control/api.h"
+#include "aether_radio/x6200_control/low/flow.h"
+
+/*
+ * Event loop on epoll. One thread waits on the flow serial port, a timerfd for keepalive
+ * (x6200_control_idle() every X6200_REFRASH_TIMEOUT), an eventfd for commands posted from other
+ * threads, user timers and user fds. All callbacks run in the thread of x6200_loop_run().
+ *
+ * Call after x6200_control_init() and x6200_flow_init().
+ */
+
+typedef void (*x6200_loop_packet_cb_t)(const x6200_flow_t *pack, void *user);
+typedef void (*x6200_loop_flags_cb_t)(x6200_flow_flags_t prev, x6200_flow_flags_t flags, void *user);
+typedef void (*x6200_loop_timer_cb_t)(void *user);
+typedef void (*x6200_loop_fd_cb_t)(int fd, uint32_t events, void *user);
+typedef void (*x6200_loop_cmd_cb_t)(void *arg);
+
+typedef struct {
+    x6200_loop_packet_cb_t  packet;             /* Every valid packet */
+    x6200_loop_flags_cb_t   flags;              /* Packet flags differ from previous packet */
+    x6200_loop_timer_cb_t   keepalive;          /* After keepalive was sent */
+    void                    *user;
+
+    uint32_t                keepalive_ms;       /* 0 - X6200_REFRASH_TIMEOUT */
+    uint32_t                flow_timeout_ms;    /* Restart flow when no packet so long, 0 - never */
+} x6200_loop_config_t;
+
+AETHER_X6200CTRL_API bool x6200_loop_init(const x6200_loop_config_t *conf);
+AETHER_X6200CTRL_API void x6200_loop_close();
+
+AETHER_X6200CTRL_API void x6200_loop_run();                         /* Until x6200_loop_stop() */
+AETHER_X6200CTRL_API bool x6200_loop_run_once(int timeout_ms);      /* -1 - wait forever */
+AETHER_X6200CTRL_API void x6200_loop_stop();                        /* Any thread */
+
+/* Run cb in loop thread. Any thread, false if queue is full */
+
+AETHER_X6200CTRL_API bool x6200_loop_post(x6200_loop_cmd_cb_t cb, void *arg);
+
+AETHER_X6200CTRL_API bool x6200_loop_fd_add(int fd, uint32_t events, x6200_loop_fd_cb_t cb, void *user);   /* EPOLLIN... */
+AETHER_X6200CTRL_API bool x6200_loop_fd_remove(int fd);
+AETHER_X6200CTRL_API bool x6200_loop_fd_modify(int fd, uint32_t events);
+
+AETHER_X6200CTRL_API int x6200_loop_timer_add(uint32_t period_ms, bool repeat, x6200_loop_timer_cb_t cb, void *user);   /* Id or -1 */
+AETHER_X6200CTRL_API bool x6200_loop_timer_remove(int id);
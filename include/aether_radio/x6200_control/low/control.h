@@ -12,6 +12,7 @@
 #include "aether_radio/x6200_control/api.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef enum
@@ -124,6 +125,11 @@ enum
     x6200_bias_final_off = 0x400000,
 };
 
+/* Bits, which start a process or an action rather than keep a setting */
+
+#define X6200_TRX_PROCESS_BITS (x6200_swrscan_trx | x6200_tune_flag | x6200_atu_tune | x6200_modem_trx | \
+                                x6200_calibration | x6200_power_off | x6200_iptt | x6200_calibration_trx)
+
 typedef enum
 {
     x6200_key_manual = 0,
@@ -156,12 +162,156 @@ typedef enum {
     x6200_dnf_auto,
 } x6200_dnf_mode_t;
 
+/* Band plan */
+
+#define X6200_BAND_PLAN_MAX 32
+
+typedef struct
+{
+    uint32_t start;     /* Hz, inclusive */
+    uint32_t end;       /* Hz, inclusive */
+} x6200_band_t;
+
+typedef enum
+{
+    x6200_region_1 = 1,     /* IARU region 1 */
+    x6200_region_2,         /* Default */
+    x6200_region_3
+} x6200_region_t;
+
+/* Batched register write */
+
+typedef struct
+{
+    x6200_cmd_enum_t cmd;
+    uint32_t arg;
+} x6200_cmd_arg_t;
+
+/* BASE info, read once at init */
+
+typedef struct
+{
+    char fpga_version[33];
+    char hw_version[33];
+    char fw_version[33];
+    char fw_date[33];
+} x6200_base_info_t;
+
+/* BASE calibration data. Layout is not known yet, so the raw payload */
+
+typedef struct
+{
+    uint8_t data[507];
+} x6200_calibration_t;
+
+/* I2C retry policy. Breaker opens after breaker_failures failed transfers in a row and drops
+   transfers for breaker_cooldown_ms; then one probe is sent, on success full mirror is pushed.
+   Breaker closes only when the mirror push succeeds too. */
+
+typedef struct
+{
+    uint8_t     retries;                /* Extra attempts per transfer */
+    uint16_t    backoff_us;             /* First retry delay, doubled every attempt, with jitter */
+    uint16_t    backoff_max_us;         /* Delay cap */
+    uint8_t     breaker_failures;       /* 0 - breaker disabled */
+    uint16_t    breaker_cooldown_ms;
+} x6200_control_retry_t;
+
+typedef struct
+{
+    uint32_t    transfers;
+    uint32_t    attempts;
+    uint32_t    failures;               /* Failed attempts */
+    uint32_t    recovered;              /* Transfers succeeded after retry */
+    uint32_t    lost;                   /* Transfers failed or dropped by breaker */
+    uint32_t    breaker_trips;
+    bool        breaker_open;
+    float       last_latency_us;
+    float       max_latency_us;
+} x6200_control_bus_stats_t;
+
+typedef void (*x6200_control_attempt_cb_t)(uint8_t attempt, bool ok, int err, float latency_us, void *user);
+
+/* Init phases timing, ms */
+
+typedef struct
+{
+    float       open_ms;
+    float       ready_ms;
+    float       base_info_ms;
+    float       calibration_ms;
+    float       host_cmd_ms;
+    float       push_ms;
+    float       total_ms;
+    uint32_t    ready_polls;
+    bool        warm;           /* Base info and registers from warm start cache */
+} x6200_control_init_stats_t;
+
+/* Keepalive period of x6200_control_idle(), ms */
+
+#define X6200_REFRASH_TIMEOUT (1 * 1000)
+
+/* Read-back result. Bit n of mask is set for register n */
+
+typedef struct
+{
+    uint64_t    mismatch_mask;
+    uint8_t     mismatches;
+    uint8_t     repaired;
+    float       read_us;
+} x6200_control_sync_t;
+
 /* Functions */
 
-AETHER_X6200CTRL_API bool x6200_control_init();
+/*
+ * Optional warm start cache. Open before x6200_control_init(). Committed registers are stored to
+ * the mapped file; on the next start with the same BASE firmware base info and calibration are
+ * not read and the saved registers are pushed instead of defaults.
+ */
+AETHER_X6200CTRL_API bool x6200_control_cache_open(const char *path);
+AETHER_X6200CTRL_API void x6200_control_cache_close();
+
+AETHER_X6200CTRL_API bool x6200_control_init();                              /* Waits BASE forever */
+AETHER_X6200CTRL_API bool x6200_control_init_timeout(uint32_t timeout_ms);    /* 0 - no timeout */
+
+/* Init in background thread, so x6200_flow_init() and x6200_gpio_init() can run meanwhile */
+
+AETHER_X6200CTRL_API bool x6200_control_init_start(uint32_t timeout_ms);      /* false, EBUSY - previous not waited */
+AETHER_X6200CTRL_API bool x6200_control_init_wait();
+AETHER_X6200CTRL_API void x6200_control_init_stats(x6200_control_init_stats_t *stats);
+
 AETHER_X6200CTRL_API bool x6200_control_cmd(x6200_cmd_enum_t cmd, uint32_t arg);
+
+AETHER_X6200CTRL_API void x6200_control_retry_set(const x6200_control_retry_t *policy);
+AETHER_X6200CTRL_API void x6200_control_retry_get(x6200_control_retry_t *policy);
+AETHER_X6200CTRL_API void x6200_control_attempt_cb_set(x6200_control_attempt_cb_t cb, void *user);   /* Called for every attempt, under bus lock */
+AETHER_X6200CTRL_API void x6200_control_bus_stats(x6200_control_bus_stats_t *stats);
+
+/*
+ * Update several registers with a single I2C_RDWR ioctl. Entries are sent in the given order,
+ * adjacent entries with consecutive registers are merged into one message.
+ */
+AETHER_X6200CTRL_API bool x6200_control_cmd_batch(const x6200_cmd_arg_t *cmds, size_t count);
 AETHER_X6200CTRL_API bool x6200_control_host_cmd(uint16_t data);
 AETHER_X6200CTRL_API void x6200_control_idle();
-AETHER_X6200CTRL_API bool x6200_control_set_band(uint32_t freq);
+
+/*
+ * Read all registers back in one transfer from the register read address and compare with the
+ * mirror. Process bits of x6200_sple_atue_trx are not compared. With repair, mismatched registers
+ * are written again in one batch. The read address of the register file is not confirmed on a
+ * real BASE, so it is not set by default and sync fails with ENOTSUP until it is. The mem and
+ * file transports serve a read-back window at X6200_TRANSPORT_READBACK_ADDR.
+ */
+AETHER_X6200CTRL_API void x6200_control_sync_addr_set(uint16_t addr);    /* 0 - not set */
+AETHER_X6200CTRL_API bool x6200_control_sync(bool repair, x6200_control_sync_t *result);
+AETHER_X6200CTRL_API bool x6200_control_set_band(uint32_t freq);   /* Band of foreground VFO, true if changed */
+
+AETHER_X6200CTRL_API bool x6200_control_band_plan_set(const x6200_band_t *bands, size_t count);  /* Sorted bands */
+AETHER_X6200CTRL_API bool x6200_control_band_plan_region(x6200_region_t region);
+AETHER_X6200CTRL_API uint8_t x6200_control_band_index(uint32_t freq);
 AETHER_X6200CTRL_API uint32_t x6200_control_get(x6200_cmd_enum_t cmd);
-AETHER_X6200CTRL_API char* x6200_control_get_fw_version();
+AETHER_X6200CTRL_API char* x6200_control_get_fw_version();      /* Raw base info, no bus access. Per thread copy, valid until next call */
+
+AETHER_X6200CTRL_API bool x6200_control_base_info_get(x6200_base_info_t *info);
+AETHER_X6200CTRL_API bool x6200_control_calibration_get(x6200_calibration_t *calibration);
+AETHER_X6200CTRL_API bool x6200_control_base_info_refresh();   /* Read base info and calibration again */
@@ -87,6 +87,14 @@ typedef struct __attribute__((__packed__))
     uint32_t crc;
 } x6200_flow_t;
 
+typedef struct
+{
+    uint32_t    replays;
+    uint32_t    suppressed;             /* Resync edges within debounce time */
+    float       last_recovery_ms;       /* Resync rise to first packet without it */
+    float       max_recovery_ms;
+} x6200_flow_resync_stats_t;
+
 /* Functions */
 
 AETHER_X6200CTRL_API bool x6200_flow_init();
@@ -94,4 +102,18 @@ AETHER_X6200CTRL_API bool x6200_flow_init();
 /* Usually a packet arrives every 35ms, sometimes the serial port dies. And then you have to reset it. */
 
 AETHER_X6200CTRL_API bool x6200_flow_restart();
+AETHER_X6200CTRL_API void x6200_flow_close();
 AETHER_X6200CTRL_API bool x6200_flow_read(x6200_flow_t *pack);
+AETHER_X6200CTRL_API int x6200_flow_fd();         /* For poll, changes after x6200_flow_restart() */
+
+/* Drop pending serial input. The next valid packet was started after this call. */
+
+AETHER_X6200CTRL_API void x6200_flow_discard();
+
+/*
+ * Replay register mirror when BASE raises resync flag. Checked in x6200_flow_read(), the mirror
+ * is pushed in one transfer on rising edge, at most once per debounce_ms.
+ */
+
+AETHER_X6200CTRL_API void x6200_flow_resync_replay(bool on, uint16_t debounce_ms);
+AETHER_X6200CTRL_API void x6200_flow_resync_stats(x6200_flow_resync_stats_t *stats);
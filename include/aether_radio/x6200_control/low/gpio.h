@@ -20,5 +20,23 @@ AETHER_X6200CTRL_API extern int x6200_pin_light;
 AETHER_X6200CTRL_API extern int x6200_pin_morse_key;
 AETHER_X6200CTRL_API extern int x6200_pin_bb_reset;
 
+/* Lines for x6200_gpio_set_many() */
+
+typedef enum {
+    X6200_GPIO_MORSE_KEY = 0,
+    X6200_GPIO_BB_RESET,
+    X6200_GPIO_USB,
+    X6200_GPIO_LIGHT,
+    X6200_GPIO_WIFI,
+
+    X6200_GPIO_LAST
+} x6200_gpio_line_t;
+
+#define X6200_GPIO_BIT(line) (1u << (line))
+
 AETHER_X6200CTRL_API bool x6200_gpio_init();
 AETHER_X6200CTRL_API void x6200_gpio_set(int pin, int value);
+
+/* Set lines of mask to bits of values. BB reset, USB and light change with a single kernel call */
+
+AETHER_X6200CTRL_API bool x6200_gpio_set_many(uint32_t mask, uint32_t values);
@@ -0,0 +1,48 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#pragma once
+
+#include "aether_radio/x6200_control/api.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * I2C transaction tracer. Every bus attempt is stored into in-memory ring, oldest entries are
+ * overwritten. Disabled tracer costs one relaxed atomic load per transfer.
+ * Can be enabled with X6200_TRACE environment variable at x6200_control_init().
+ */
+
+#define X6200_TRACE_ENTRIES 1024
+#define X6200_TRACE_PAYLOAD 24
+
+typedef struct
+{
+    uint64_t    timestamp_ns;       /* CLOCK_MONOTONIC */
+    uint32_t    duration_ns;
+    uint16_t    reg;                /* Register address of the first message */
+    uint16_t    len;                /* Full payload length, can be more than stored */
+    uint8_t     stored;             /* Bytes in payload, first message only */
+    uint8_t     nmsgs;
+    bool        read;
+    bool        ok;
+    int16_t     err;                /* errno */
+    uint8_t     payload[X6200_TRACE_PAYLOAD];   /* Written data of the first message or read back data */
+} x6200_trace_entry_t;
+
+typedef void (*x6200_trace_cb_t)(const x6200_trace_entry_t *entry, void *user);
+
+AETHER_X6200CTRL_API void x6200_trace_enable(bool on);
+AETHER_X6200CTRL_API void x6200_trace_clear();
+
+AETHER_X6200CTRL_API size_t x6200_trace_read(x6200_trace_entry_t *entries, size_t max);    /* Oldest first */
+AETHER_X6200CTRL_API size_t x6200_trace_dump_cb(x6200_trace_cb_t cb, void *user);
+AETHER_X6200CTRL_API bool x6200_trace_dump(const char *path);
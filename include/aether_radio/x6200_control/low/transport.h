@@ -0,0 +1,100 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#pragma once
+
+#include "aether_radio/x6200_control/api.h"
+
+#include <linux/i2c.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * Transport backends for BASE control (I2C), flow (serial) and GPIO.
+ *
+ * Built-in backends:
+ *   kernel - real devices. Overridable with X6200_I2C_DEV (/dev/i2c-0), X6200_I2C_ADDR (0x72),
+ *            X6200_FLOW_DEV (/dev/ttyS1), X6200_GPIO_CHIP0 / X6200_GPIO_CHIP1 (gpiochip0/1),
+ *            so gpio-sim chips can be used instead. I2C needs a bus with plain I2C_RDWR
+ *            transfers, SMBus-only adapters (i2c-stub) don't work - use file backend there.
+ *   mem    - in-process: 64K register and info spaces, pipe for flow, array of pin values.
+ *   file   - both spaces mapped from X6200_I2C_FILE (/tmp/x6200_regs), flow read from
+ *            X6200_FLOW_FILE (pty or capture), GPIO changes logged to X6200_GPIO_FILE (stderr).
+ *            Opening clears the ready flag, BASE simulator (examples/sim.c) serves the file.
+ *
+ * Backend is taken from X6200_TRANSPORT environment variable (default kernel) on first use,
+ * or set with functions below before init.
+ */
+
+typedef struct
+{
+    const char  *name;
+    bool        (*open)(void);
+    void        (*close)(void);
+    bool        (*transfer)(struct i2c_msg *messages, uint32_t nmsgs);     /* false and errno on error */
+} x6200_i2c_transport_t;
+
+typedef struct
+{
+    const char  *name;
+    int         (*open)(void);                          /* Pollable fd or -1 */
+    void        (*close)(int fd);
+    ssize_t     (*read)(int fd, void *buf, size_t len);
+    void        (*flush)(int fd);                       /* Drop pending input */
+} x6200_flow_transport_t;
+
+typedef struct
+{
+    const char  *name;
+    bool        (*init)(void);
+    bool        (*set)(int pin, int value);
+    bool        (*set_many)(uint32_t mask, uint32_t values);    /* X6200_GPIO_BIT() mask, NULL - set() per line */
+} x6200_gpio_transport_t;
+
+AETHER_X6200CTRL_API extern const x6200_i2c_transport_t x6200_i2c_kernel;
+AETHER_X6200CTRL_API extern const x6200_i2c_transport_t x6200_i2c_mem;
+AETHER_X6200CTRL_API extern const x6200_i2c_transport_t x6200_i2c_file;
+
+AETHER_X6200CTRL_API extern const x6200_flow_transport_t x6200_flow_kernel;
+AETHER_X6200CTRL_API extern const x6200_flow_transport_t x6200_flow_mem;
+AETHER_X6200CTRL_API extern const x6200_flow_transport_t x6200_flow_file;
+
+AETHER_X6200CTRL_API extern const x6200_gpio_transport_t x6200_gpio_kernel;
+AETHER_X6200CTRL_API extern const x6200_gpio_transport_t x6200_gpio_mem;
+AETHER_X6200CTRL_API extern const x6200_gpio_transport_t x6200_gpio_file;
+
+/* Selection */
+
+AETHER_X6200CTRL_API bool x6200_transport_select(const char *name);    /* "kernel", "mem" or "file" for all */
+
+AETHER_X6200CTRL_API void x6200_transport_i2c_set(const x6200_i2c_transport_t *transport);
+AETHER_X6200CTRL_API void x6200_transport_flow_set(const x6200_flow_transport_t *transport);
+AETHER_X6200CTRL_API void x6200_transport_gpio_set(const x6200_gpio_transport_t *transport);
+
+AETHER_X6200CTRL_API const x6200_i2c_transport_t *x6200_transport_i2c();
+AETHER_X6200CTRL_API const x6200_flow_transport_t *x6200_transport_flow();
+AETHER_X6200CTRL_API const x6200_gpio_transport_t *x6200_transport_gpio();
+
+/*
+ * Memory backend access. Host writes land in the register space, host reads are served
+ * from the read-only info space: BASE info at 0x0000, calibration at 0x100, ready flag at
+ * 0x2000. Reads from X6200_TRANSPORT_READBACK_ADDR on are served from the register space, for
+ * x6200_control_sync(). The file backend maps the info space right after the register space.
+ */
+
+#define X6200_TRANSPORT_REGS_SIZE 0x10000
+#define X6200_TRANSPORT_READBACK_ADDR 0x4000      /* Reads from here on return the register space */
+#define X6200_TRANSPORT_FILE_SIZE (X6200_TRANSPORT_REGS_SIZE * 2)
+
+AETHER_X6200CTRL_API uint8_t *x6200_transport_mem_regs();                          /* Register space, byte addressed */
+AETHER_X6200CTRL_API uint8_t *x6200_transport_mem_info();                          /* Info space, byte addressed */
+AETHER_X6200CTRL_API bool x6200_transport_mem_flow_write(const void *data, size_t len);  /* Feed flow stream */
+AETHER_X6200CTRL_API int x6200_transport_mem_gpio_get(int pin);
@@ -0,0 +1,65 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aether_radio/x6200_control/control.h"
+#include "aether_radio/x6200_control/low/flow.h"
+
+/*
+ * Channel scanner. Application keeps reading flow and passes every packet to
+ * x6200_scan_process(). After retune the serial input is discarded and the first valid packet
+ * is taken as the first one from the new frequency. That's an approximation: BASE may still be
+ * sending a packet measured before retune, use skip_packets when it matters. Settle time is
+ * measured, not slept, and it's really the time to the next packet boundary after retune.
+ * Time held on active channel is not counted in channels_per_sec.
+ */
+
+typedef enum {
+    X6200_SCAN_IDLE = 0,
+    X6200_SCAN_SETTLING,    /* Retune sent, waiting for packet from new frequency */
+    X6200_SCAN_LISTENING,   /* Checking channel for activity */
+    X6200_SCAN_ACTIVE,      /* Activity found, scanner holds on channel */
+} x6200_scan_state_t;
+
+typedef struct {
+    x6200_vfo_t     vfo;
+
+    const uint32_t  *freqs;         /* Frequency list, or NULL to use range */
+    size_t          freqs_count;
+
+    uint32_t        start;          /* Range, used when freqs is NULL */
+    uint32_t        stop;
+    uint32_t        step;
+
+    bool            use_sql;        /* Activity when flag.sql_mute is low */
+    uint8_t         dbm;            /* Activity when dbm >= this value, 0 - disabled */
+
+    uint8_t         skip_packets;   /* Packets ignored after the first one following retune */
+    uint8_t         dwell_packets;  /* Fresh packets to check per channel, min 1 */
+    uint16_t        hang_ms;        /* Resume after activity is gone so long, 0 - hold until resume */
+} x6200_scan_config_t;
+
+typedef struct {
+    uint32_t    channels;           /* Checked channels since start */
+    float       channels_per_sec;
+    float       settle_ms;          /* Last measured retune to first packet time */
+    float       settle_avg_ms;
+} x6200_scan_stats_t;
+
+AETHER_X6200CTRL_API bool x6200_scan_start(const x6200_scan_config_t *conf);
+AETHER_X6200CTRL_API void x6200_scan_stop();
+AETHER_X6200CTRL_API void x6200_scan_resume();                         /* Leave active channel */
+
+AETHER_X6200CTRL_API x6200_scan_state_t x6200_scan_process(const x6200_flow_t *pack);
+
+AETHER_X6200CTRL_API uint32_t x6200_scan_freq();
+AETHER_X6200CTRL_API void x6200_scan_stats(x6200_scan_stats_t *stats);
@@ -0,0 +1,90 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "aether_radio/x6200_control/api.h"
+#include "aether_radio/x6200_control/codec.h"
+#include "aether_radio/x6200_control/low/flow.h"
+
+/*
+ * Spectrum streaming over UDP. Every flow packet becomes one datagram: header and spectrum
+ * payload, sent to all destinations (unicast or multicast groups). Datagrams of a batch of
+ * packets for all destinations go in one sendmmsg(). Buffers and message vectors are
+ * allocated once in x6200_stream_init().
+ *
+ * All header fields and raw samples are little endian, converted on send. Subscribers on
+ * big endian hosts convert them back with le16toh() and friends.
+ */
+
+#define X6200_STREAM_MAGIC      0x53323658      /* "X62S" */
+#define X6200_STREAM_VERSION    1
+#define X6200_STREAM_PORT       50200
+#define X6200_STREAM_SAMPLES    512
+
+#define X6200_STREAM_MAX_DESTS  8
+#define X6200_STREAM_MAX_BATCH  8
+
+typedef enum {
+    X6200_STREAM_RAW = 0,       /* float samples[512] as in flow packet */
+    X6200_STREAM_SPECTRUM,      /* x6200_codec_encode() line, x6200_codec_decode() on subscriber */
+} x6200_stream_format_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint32_t    magic;
+    uint8_t     version;
+    uint8_t     format;         /* x6200_stream_format_t */
+    uint16_t    payload_len;    /* Bytes after header */
+    uint32_t    seq;            /* +1 every packet, gaps are lost datagrams */
+    uint64_t    timestamp_us;   /* CLOCK_REALTIME when packet was read */
+    uint32_t    freq;           /* Foreground VFO */
+    uint8_t     mode;           /* x6200_mode_t */
+    uint8_t     vfo;
+    uint8_t     dbm;            /* Telemetry as in x6200_flow_t */
+    uint8_t     tx_power;
+    uint8_t     vswr;
+    uint8_t     alc_level;
+    uint8_t     vext;
+    uint8_t     vbat;
+    uint8_t     batcap;
+    uint8_t     reserved[3];
+    uint32_t    flags;          /* x6200_flow_flags_t */
+} x6200_stream_header_t;
+
+typedef struct {
+    x6200_stream_format_t   format;
+    x6200_codec_config_t    codec;      /* X6200_STREAM_SPECTRUM fidelity */
+    uint8_t                 batch;      /* Packets per sendmmsg(), 0 - 1. Adds (batch - 1) * 35 ms latency */
+    uint8_t                 ttl;        /* Multicast TTL, 0 - 1 (local network) */
+    const char              *iface;     /* Multicast interface address, NULL - default route */
+} x6200_stream_config_t;
+
+typedef struct {
+    uint32_t    packets;
+    uint32_t    datagrams;
+    uint32_t    syscalls;
+    uint32_t    errors;             /* Datagrams not sent */
+    uint64_t    bytes;
+} x6200_stream_stats_t;
+
+AETHER_X6200CTRL_API bool x6200_stream_init(const x6200_stream_config_t *conf);
+AETHER_X6200CTRL_API void x6200_stream_close();
+
+AETHER_X6200CTRL_API bool x6200_stream_dest_add(const char *host, uint16_t port);      /* IPv4 unicast or multicast group */
+AETHER_X6200CTRL_API bool x6200_stream_dest_remove(const char *host, uint16_t port);
+
+/* Encode packet into next buffer, send batch when full */
+
+AETHER_X6200CTRL_API bool x6200_stream_packet(const x6200_flow_t *pack);
+AETHER_X6200CTRL_API bool x6200_stream_flush();
+
+AETHER_X6200CTRL_API void x6200_stream_stats(x6200_stream_stats_t *stats);
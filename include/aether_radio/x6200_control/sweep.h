@@ -0,0 +1,74 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg a.k.a. R1CBU
+ *  Copyright (c) 2022 Rui Oliveira a.k.a. CT7ALW
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "aether_radio/x6200_control/control.h"
+#include "aether_radio/x6200_control/low/flow.h"
+
+/*
+ * SWR sweep in swrscan mode. Application passes every packet to x6200_sweep_process(). After
+ * each step the serial input is discarded, and a point is taken when consecutive fresh TX
+ * packets agree on vswr, so a step lasts as long as the reading needs to settle. Swrscan is
+ * switched off and the frequency restored as soon as the sweep ends.
+ *
+ * Only the foreground VFO can be swept, BASE transmits on it. Sweeps of more than
+ * X6200_SWEEP_MAX_POINTS points are rejected.
+ */
+
+#define X6200_SWEEP_MAX_POINTS  4096
+
+typedef enum {
+    X6200_SWEEP_IDLE = 0,
+    X6200_SWEEP_SETTLING,       /* Retune sent, waiting for fresh TX packet */
+    X6200_SWEEP_MEASURING,      /* Waiting for vswr to settle */
+    X6200_SWEEP_DONE,
+    X6200_SWEEP_FAILED,         /* No TX, SWR limit or abort */
+} x6200_sweep_state_t;
+
+typedef struct {
+    x6200_vfo_t vfo;
+    uint32_t    start;
+    uint32_t    stop;
+    uint32_t    step;
+
+    float       tolerance;          /* Settled when readings differ by this or less, 0 - 0.1 */
+    uint8_t     settle_packets;     /* Readings in a row within tolerance, 0 - 2 */
+    uint8_t     max_packets;        /* Per step, then the last reading is taken, 0 - 8 */
+    float       max_swr;            /* Stop sweep above, 0 - no limit */
+} x6200_sweep_config_t;
+
+typedef struct {
+    uint32_t    freq;
+    float       swr;
+    float       power;              /* W */
+} x6200_sweep_point_t;
+
+typedef struct {
+    const x6200_sweep_point_t   *points;
+    size_t                      count;
+
+    size_t                      min_index;
+    uint32_t                    bw_low;         /* SWR 2:1 edges, interpolated. 0 - not found */
+    uint32_t                    bw_high;
+    float                       elapsed_ms;
+    uint32_t                    packets;        /* TX packets, RF exposure */
+} x6200_sweep_result_t;
+
+AETHER_X6200CTRL_API bool x6200_sweep_start(const x6200_sweep_config_t *conf);
+AETHER_X6200CTRL_API void x6200_sweep_abort();
+
+AETHER_X6200CTRL_API x6200_sweep_state_t x6200_sweep_process(const x6200_flow_t *pack);
+
+/* Points measured so far. Valid until next x6200_sweep_start() */
+
+AETHER_X6200CTRL_API bool x6200_sweep_result(x6200_sweep_result_t *result);
@@ -0,0 +1,345 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#include "aether_radio/x6200_control/atu.h"
+#include "control_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    uint32_t    segment;
+    uint32_t    params;
+} entry_t;
+
+static x6200_atu_config_t   conf = { .segment_hz = 25000 };
+static char                 *path = NULL;
+
+static entry_t              *entries = NULL;    /* Sorted by segment */
+static size_t               entries_count = 0;
+static size_t               entries_size = 0;
+
+static x6200_atu_state_t    state = X6200_ATU_IDLE;
+static x6200_atu_result_t   result = X6200_ATU_NONE;
+static uint32_t             tune_segment;
+static double               tune_time;
+static uint32_t             last_segment = UINT32_MAX;
+
+static x6200_atu_stats_t    stats;
+
+static double now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static uint32_t fg_freq()
+{
+    bool vfo_b = (x6200_control_get(x6200_vi_vm) & 0xFF) != 0;
+
+    return x6200_control_get(vfo_b ? x6200_vfob_freq : x6200_vfoa_freq);
+}
+
+static uint32_t segment(uint32_t freq)
+{
+    return freq / conf.segment_hz;
+}
+
+/* Index */
+
+static size_t find(uint32_t seg, bool *found)
+{
+    size_t lo = 0;
+    size_t hi = entries_count;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+
+        if (entries[mid].segment < seg) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = lo < entries_count && entries[lo].segment == seg;
+    return lo;
+}
+
+static bool insert(uint32_t seg, uint32_t params)
+{
+    bool    found;
+    size_t  i = find(seg, &found);
+
+    if (found) {
+        entries[i].params = params;
+        return true;
+    }
+
+    if (entries_count == entries_size) {
+        size_t  size = entries_size ? entries_size * 2 : 64;
+        entry_t *p = realloc(entries, size * sizeof(entry_t));
+
+        if (!p) {
+            return false;
+        }
+        entries = p;
+        entries_size = size;
+    }
+    memmove(&entries[i + 1], &entries[i], (entries_count - i) * sizeof(entry_t));
+    entries[i].segment = seg;
+    entries[i].params = params;
+    entries_count++;
+
+    return true;
+}
+
+/* File */
+
+static void load()
+{
+    FILE        *f = fopen(path, "r");
+    uint32_t    freq, params;
+
+    if (!f) {
+        return;
+    }
+    while (fscanf(f, "%u %x", &freq, &params) == 2) {
+        insert(segment(freq), params);
+    }
+    fclose(f);
+}
+
+static void save()
+{
+    if (!path) {
+        return;
+    }
+
+    char    tmp[strlen(path) + 5];
+    FILE    *f;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    f = fopen(tmp, "w");
+
+    if (!f) {
+        perror("Can't save ATU memory");
+        return;
+    }
+    for (size_t i = 0; i < entries_count; i++) {
+        fprintf(f, "%u %08X\n", entries[i].segment * conf.segment_hz, entries[i].params);
+    }
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        perror("Can't save ATU memory");
+    }
+}
+
+/* Engine */
+
+static void restore(uint32_t params)
+{
+    if (x6200_control_get(x6200_atu_network) != params) {
+        x6200_control_cmd(x6200_atu_network, params);
+    }
+    stats.restores++;
+    result = X6200_ATU_RESTORED;
+}
+
+static void finish(x6200_atu_result_t res)
+{
+    x6200_control_atu_tune(false);
+    state = X6200_ATU_IDLE;
+    result = res;
+
+    if (res == X6200_ATU_FAILED) {
+        stats.failures++;
+    }
+}
+
+bool x6200_atu_init(const x6200_atu_config_t *c)
+{
+    x6200_atu_close();
+
+    conf = *c;
+
+    if (conf.segment_hz == 0) {
+        conf.segment_hz = 25000;
+    }
+    if (conf.start_timeout_ms == 0) {
+        conf.start_timeout_ms = 1000;
+    }
+    if (conf.tune_timeout_ms == 0) {
+        conf.tune_timeout_ms = 10000;
+    }
+    if (conf.path) {
+        path = strdup(conf.path);
+
+        if (!path) {
+            return false;
+        }
+        load();
+    }
+    conf.path = NULL;
+
+    memset(&stats, 0, sizeof(stats));
+    state = X6200_ATU_IDLE;
+    result = X6200_ATU_NONE;
+    last_segment = UINT32_MAX;
+
+    return true;
+}
+
+void x6200_atu_close()
+{
+    if (state != X6200_ATU_IDLE) {
+        finish(X6200_ATU_FAILED);
+    }
+    free(entries);
+    free(path);
+    entries = NULL;
+    entries_count = 0;
+    entries_size = 0;
+    path = NULL;
+}
+
+x6200_atu_result_t x6200_atu_start(bool force)
+{
+    uint32_t    seg = segment(fg_freq());
+    bool        found;
+    size_t      i = find(seg, &found);
+
+    if (state != X6200_ATU_IDLE) {
+        return X6200_ATU_FAILED;
+    }
+    last_segment = seg;
+
+    if (found && !force) {
+        restore(entries[i].params);
+        return result;
+    }
+
+    tune_segment = seg;
+    tune_time = now_ms();
+    state = X6200_ATU_STARTING;
+    result = X6200_ATU_STARTED;
+
+    x6200_control_atu_tune(true);
+    return result;
+}
+
+void x6200_atu_abort()
+{
+    if (state != X6200_ATU_IDLE) {
+        finish(X6200_ATU_FAILED);
+    }
+}
+
+x6200_atu_state_t x6200_atu_process(const x6200_flow_t *pack)
+{
+    double now = now_ms();
+
+    switch (state) {
+        case X6200_ATU_IDLE:
+            if (conf.auto_restore && !pack->flag.tx && (x6200_control_get(x6200_sple_atue_trx) & x6200_atue)) {
+                uint32_t seg = segment(fg_freq());
+
+                if (seg != last_segment) {
+                    bool    found;
+                    size_t  i = find(seg, &found);
+
+                    last_segment = seg;
+
+                    if (found) {
+                        restore(entries[i].params);
+                    }
+                }
+            }
+            break;
+
+        case X6200_ATU_STARTING:
+            if (pack->flag.tx) {
+                state = X6200_ATU_TUNING;
+            } else if (now - tune_time > conf.start_timeout_ms) {
+                finish(X6200_ATU_FAILED);
+            }
+            break;
+
+        case X6200_ATU_TUNING:
+            if (!pack->flag.tx) {
+                stats.last_tune_ms = now - tune_time;
+
+                if (pack->atu_params == 0) {
+                    finish(X6200_ATU_FAILED);
+                    break;
+                }
+
+                /* BASE already runs the tuned network. Mirror takes it without a write, so
+                   keepalive pushes, snapshots and sync carry it instead of the old value */
+
+                x6200_control_mirror_set(x6200_atu_network, pack->atu_params);
+                insert(tune_segment, pack->atu_params);
+                save();
+
+                stats.tunes++;
+                finish(X6200_ATU_TUNED);
+            } else if (now - tune_time > conf.tune_timeout_ms) {
+                finish(X6200_ATU_FAILED);
+            }
+            break;
+    }
+    return state;
+}
+
+x6200_atu_state_t x6200_atu_state()
+{
+    return state;
+}
+
+x6200_atu_result_t x6200_atu_result()
+{
+    return result;
+}
+
+bool x6200_atu_lookup(uint32_t freq, uint32_t *params)
+{
+    bool    found;
+    size_t  i = find(segment(freq), &found);
+
+    if (found && params) {
+        *params = entries[i].params;
+    }
+    return found;
+}
+
+void x6200_atu_forget(uint32_t freq)
+{
+    if (freq == 0) {
+        entries_count = 0;
+    } else {
+        bool    found;
+        size_t  i = find(segment(freq), &found);
+
+        if (!found) {
+            return;
+        }
+        memmove(&entries[i], &entries[i + 1], (entries_count - i - 1) * sizeof(entry_t));
+        entries_count--;
+    }
+    last_segment = UINT32_MAX;
+    save();
+}
+
+void x6200_atu_stats(x6200_atu_stats_t *s)
+{
+    *s = stats;
+    s->entries = entries_count;
+}
@@ -0,0 +1,338 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#include "aether_radio/x6200_control/codec.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#define BINS            X6200_CODEC_BINS
+#define BLOCK           16
+#define BLOCKS          (BINS / BLOCK)
+#define HEADER_SIZE     4
+#define ESCAPE          20          /* Unary length which means raw value follows */
+#define RAW_BITS        20
+#define STEP_UNIT       0.05f       /* Step on the wire */
+
+#define FLAG_KEY        0x01
+
+/*
+ * Line:
+ *   flags, line number, step in STEP_UNIT, reserved
+ *   per block: predictor bit (not in keyframe: 0 - previous line, 1 - lower bin), Rice k (4 bits),
+ *   16 residuals as zigzag Rice codes. Bits go LSB first.
+ */
+
+static pthread_once_t   tables_once = PTHREAD_ONCE_INIT;
+static float            window[BINS];
+static float            tw_re[BINS / 2];
+static float            tw_im[BINS / 2];
+static uint8_t          bitrev[BINS];
+static float            norm_db;
+
+static void tables_init()
+{
+    float sum = 0.0f;
+
+    for (int i = 0; i < BINS; i++) {
+        window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / BINS);
+        sum += window[i];
+
+        uint8_t r = 0;
+
+        for (int b = 0; b < 8; b++) {
+            r |= ((i >> b) & 1) << (7 - b);
+        }
+        bitrev[i] = r;
+    }
+    for (int i = 0; i < BINS / 2; i++) {
+        tw_re[i] = cosf(2.0f * (float)M_PI * i / BINS);
+        tw_im[i] = -sinf(2.0f * (float)M_PI * i / BINS);
+    }
+    norm_db = 20.0f * log10f(sum);
+}
+
+/* Spectrum */
+
+void x6200_codec_spectrum(const x6200_flow_t *pack, float db[BINS])
+{
+    float re[BINS], im[BINS];
+
+    pthread_once(&tables_once, tables_init);
+
+    for (int i = 0; i < BINS; i++) {
+        re[bitrev[i]] = pack->samples[i * 2] * window[i];
+        im[bitrev[i]] = pack->samples[i * 2 + 1] * window[i];
+    }
+
+    for (int size = 2; size <= BINS; size *= 2) {
+        int half = size / 2;
+        int step = BINS / size;
+
+        for (int start = 0; start < BINS; start += size) {
+            for (int k = 0; k < half; k++) {
+                float   wr = tw_re[k * step];
+                float   wi = tw_im[k * step];
+                int     a = start + k;
+                int     b = a + half;
+                float   tr = re[b] * wr - im[b] * wi;
+                float   ti = re[b] * wi + im[b] * wr;
+
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+
+    for (int i = 0; i < BINS; i++) {
+        db[(i + BINS / 2) % BINS] = 10.0f * log10f(re[i] * re[i] + im[i] * im[i] + 1e-20f) - norm_db;
+    }
+}
+
+/* Bits */
+
+typedef struct {
+    uint8_t     *buf;
+    size_t      pos;
+    uint64_t    acc;
+    int         n;
+} writer_t;
+
+typedef struct {
+    const uint8_t   *buf;
+    size_t          len;
+    size_t          pos;
+    uint64_t        acc;
+    int             n;
+    size_t          used;
+} reader_t;
+
+static inline void put(writer_t *w, uint32_t v, int bits)
+{
+    w->acc |= (uint64_t)v << w->n;
+    w->n += bits;
+
+    while (w->n >= 8) {
+        w->buf[w->pos++] = w->acc;
+        w->acc >>= 8;
+        w->n -= 8;
+    }
+}
+
+static inline void put_flush(writer_t *w)
+{
+    if (w->n > 0) {
+        w->buf[w->pos++] = w->acc;
+        w->acc = 0;
+        w->n = 0;
+    }
+}
+
+static inline void refill(reader_t *r)
+{
+    while (r->n <= 56) {
+        r->acc |= (uint64_t)(r->pos < r->len ? r->buf[r->pos] : 0) << r->n;
+        r->pos++;
+        r->n += 8;
+    }
+}
+
+static inline uint32_t get(reader_t *r, int bits)
+{
+    refill(r);
+
+    uint32_t v = r->acc & ((1ull << bits) - 1);
+
+    r->acc >>= bits;
+    r->n -= bits;
+    r->used += bits;
+
+    return v;
+}
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static inline void rice_put(writer_t *w, uint32_t v, int k)
+{
+    uint32_t q = v >> k;
+
+    if (q >= ESCAPE) {
+        put(w, (1u << ESCAPE) - 1, ESCAPE);
+        put(w, v, RAW_BITS);
+    } else {
+        put(w, (1u << q) - 1, q + 1);       /* Ones and terminating zero */
+        put(w, v & ((1u << k) - 1), k);
+    }
+}
+
+static inline uint32_t rice_get(reader_t *r, int k)
+{
+    refill(r);
+
+    int q = __builtin_ctzll(~r->acc);
+
+    if (q >= ESCAPE) {
+        get(r, ESCAPE);
+        return get(r, RAW_BITS);
+    }
+    get(r, q + 1);
+    return (q << k) | get(r, k);
+}
+
+static int rice_k(uint32_t sum)
+{
+    int k = 0;
+
+    while (k < 15 && ((uint32_t)BLOCK << (k + 1)) <= sum) {
+        k++;
+    }
+    return k;
+}
+
+/* Codec */
+
+void x6200_codec_init(x6200_codec_t *c, const x6200_codec_config_t *conf)
+{
+    memset(c, 0, sizeof(*c));
+    c->conf = *conf;
+
+    if (c->conf.step_db <= 0.0f) {
+        c->conf.step_db = 1.0f;
+    }
+    if (c->conf.keyframe == 0) {
+        c->conf.keyframe = 16;
+    }
+
+    float step = roundf(c->conf.step_db / STEP_UNIT);
+
+    c->step = step < 1.0f ? 1 : step > 255.0f ? 255 : step;
+    c->conf.step_db = c->step * STEP_UNIT;
+}
+
+size_t x6200_codec_encode(x6200_codec_t *c, const float db[BINS], uint8_t *out)
+{
+    int16_t     q[BINS];
+    uint32_t    res[BINS];
+    float       scale = 1.0f / c->conf.step_db;
+    bool        key = !c->valid || c->since_key == 0;
+    writer_t    w = { .buf = out, .pos = HEADER_SIZE };
+
+    for (int i = 0; i < BINS; i++) {
+        float v = roundf(db[i] * scale);
+
+        q[i] = v < -32767.0f ? -32767 : v > 32767.0f ? 32767 : (int16_t)v;
+    }
+
+    for (int b = 0; b < BLOCKS; b++) {
+        int         first = b * BLOCK;
+        uint32_t    sum_space = 0;
+        uint32_t    sum_time = UINT32_MAX;
+
+        for (int i = first; i < first + BLOCK; i++) {
+            sum_space += zigzag(q[i] - (i ? q[i - 1] : 0));
+        }
+
+        if (!key) {
+            sum_time = 0;
+
+            for (int i = first; i < first + BLOCK; i++) {
+                sum_time += zigzag(q[i] - c->prev[i]);
+            }
+        }
+
+        bool        space = sum_space <= sum_time;
+        uint32_t    sum = space ? sum_space : sum_time;
+        int         k = rice_k(sum);
+
+        for (int i = first; i < first + BLOCK; i++) {
+            res[i] = zigzag(q[i] - (space ? (i ? q[i - 1] : 0) : c->prev[i]));
+        }
+
+        if (!key) {
+            put(&w, space, 1);
+        }
+        put(&w, k, 4);
+
+        for (int i = first; i < first + BLOCK; i++) {
+            rice_put(&w, res[i], k);
+        }
+    }
+    put_flush(&w);
+
+    c->line++;
+    c->since_key = (c->since_key + 1) % c->conf.keyframe;
+    c->valid = true;
+    memcpy(c->prev, q, sizeof(q));
+
+    out[0] = key ? FLAG_KEY : 0;
+    out[1] = c->line;
+    out[2] = c->step;
+    out[3] = 0;
+
+    return w.pos;
+}
+
+bool x6200_codec_decode(x6200_codec_t *c, const uint8_t *in, size_t len, float db[BINS])
+{
+    int16_t     q[BINS];
+    reader_t    r = { .buf = in + HEADER_SIZE };
+
+    if (len < HEADER_SIZE) {
+        return false;
+    }
+
+    bool key = in[0] & FLAG_KEY;
+
+    if (!key && (!c->valid || in[1] != (uint8_t)(c->line + 1) || in[2] != c->step)) {
+        c->valid = false;
+        return false;
+    }
+    r.len = len - HEADER_SIZE;
+
+    for (int b = 0; b < BLOCKS; b++) {
+        int     first = b * BLOCK;
+        bool    space = key ? true : get(&r, 1);
+        int     k = get(&r, 4);
+
+        for (int i = first; i < first + BLOCK; i++) {
+            int32_t pred = space ? (i ? q[i - 1] : 0) : c->prev[i];
+
+            q[i] = pred + unzigzag(rice_get(&r, k));
+        }
+    }
+
+    if (r.used > r.len * 8 || in[2] == 0) {
+        c->valid = false;
+        return false;
+    }
+
+    float step = in[2] * STEP_UNIT;
+
+    for (int i = 0; i < BINS; i++) {
+        db[i] = q[i] * step;
+    }
+
+    c->line = in[1];
+    c->step = in[2];
+    c->valid = true;
+    memcpy(c->prev, q, sizeof(q));
+
+    return true;
+}
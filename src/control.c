@@ -9,18 +9,130 @@
 
 #include <unistd.h>
 #include <signal.h>
+#include <string.h>
 #include "aether_radio/x6200_control/control.h"
 #include "aether_radio/x6200_control/low/flow.h"
+#include "control_internal.h"
+
+#define SNAPSHOT_MAGIC 0x58365301
+
+typedef struct __attribute__((__packed__))
+{
+    uint32_t magic;
+    uint32_t arg[x6200_last + 1];
+    uint8_t  fg_vfo;
+    uint8_t  vfo_modes[2];
+    uint8_t  reserved;
+} snapshot_t;
+
+_Static_assert(sizeof(snapshot_t) == X6200_SNAPSHOT_SIZE, "X6200_SNAPSHOT_SIZE mismatch");
 
 static x6200_vfo_t fg_vfo;
 static x6200_mode_t vfo_modes[2] = {x6200_mode_lsb, x6200_mode_lsb};
 
+void x6200_control_state_load()
+{
+    fg_vfo = (x6200_control_get(x6200_vi_vm) & 0xFF) ? X6200_VFO_B : X6200_VFO_A;
+    vfo_modes[X6200_VFO_A] = x6200_control_get(x6200_vfoa_mode);
+    vfo_modes[X6200_VFO_B] = x6200_control_get(x6200_vfob_mode);
+}
+
+/* State snapshot */
+
+void x6200_control_snapshot(x6200_snapshot_t *snap)
+{
+    snapshot_t *p = (snapshot_t *)snap->data;
+
+    memset(p, 0, sizeof(*p));
+    p->magic = SNAPSHOT_MAGIC;
+
+    for (int i = 0; i <= x6200_last; i++) {
+        p->arg[i] = x6200_control_get(i);
+    }
+    p->fg_vfo = fg_vfo;
+    p->vfo_modes[0] = vfo_modes[0];
+    p->vfo_modes[1] = vfo_modes[1];
+}
+
+bool x6200_control_restore(const x6200_snapshot_t *snap)
+{
+    const snapshot_t    *p = (const snapshot_t *)snap->data;
+    x6200_cmd_arg_t     cmds[x6200_last + 1];
+    size_t              count = 0;
+
+    if (p->magic != SNAPSHOT_MAGIC) {
+        return false;
+    }
+
+    /* Filter goes first, so the new mode never starts with the old passband */
+
+    if (p->arg[x6200_rxfilter] != x6200_control_get(x6200_rxfilter)) {
+        cmds[count].cmd = x6200_rxfilter;
+        cmds[count].arg = p->arg[x6200_rxfilter];
+        count++;
+    }
+
+    for (int i = 0; i <= x6200_last; i++) {
+        uint32_t cur = x6200_control_get(i);
+        uint32_t next = p->arg[i];
+
+        /* Process bits are not a part of state */
+        if (i == x6200_sple_atue_trx) {
+            next = (next & ~X6200_TRX_PROCESS_BITS) | (cur & X6200_TRX_PROCESS_BITS);
+        }
+        if (i != x6200_rxfilter && next != cur) {
+            cmds[count].cmd = i;
+            cmds[count].arg = next;
+            count++;
+        }
+    }
+
+    fg_vfo = p->fg_vfo;
+    vfo_modes[0] = p->vfo_modes[0];
+    vfo_modes[1] = p->vfo_modes[1];
+
+    if (count == 0) {
+        return true;
+    }
+    return x6200_control_cmd_batch(cmds, count);
+}
+
+static const x6200_cmd_enum_t filter_regs[X6200_FILTER_LAST] = {
+    x6200_filter_ssb,
+    x6200_filter_cw,
+    x6200_filter_am,
+    x6200_filter_nfm,
+    x6200_filter_wfm,
+};
+
 /* VFO Settings */
 
+static x6200_mode_t vfo_mode(x6200_vfo_t vfo)
+{
+    return x6200_control_get(vfo == X6200_VFO_A ? x6200_vfoa_mode : x6200_vfob_mode);
+}
+
 void x6200_control_vfo_mode_set(x6200_vfo_t vfo, x6200_mode_t mode)
 {
+    x6200_cmd_enum_t mode_reg = vfo == X6200_VFO_A ? x6200_vfoa_mode : x6200_vfob_mode;
+
     vfo_modes[vfo] = mode;
-    x6200_control_cmd(vfo == X6200_VFO_A ? x6200_vfoa_mode : x6200_vfob_mode, mode);
+
+    if (vfo != fg_vfo) {
+        x6200_control_cmd(mode_reg, mode);
+        return;
+    }
+
+    /* Filter goes first, so the new mode never starts with the old passband */
+
+    uint32_t filter = x6200_control_filter_bank_packed(x6200_control_filter_group(mode));
+
+    x6200_cmd_arg_t cmds[] = {
+        { x6200_rxfilter, filter },
+        { mode_reg, mode },
+    };
+
+    x6200_control_cmd_batch(cmds, 2);
 }
 
 void x6200_control_vfo_freq_set(x6200_vfo_t vfo, uint32_t freq)
@@ -89,66 +201,82 @@ void x6200_control_spmode_set(bool phone)
 
 /* Filters */
 
-void x6200_control_ssb_filter_set_set(uint16_t low, uint16_t high)
+static uint32_t filter_pack(int16_t low, int16_t high)
 {
-    uint32_t val = (((uint32_t)high) << 16) + low;
-    x6200_control_cmd(x6200_filter_ssb, val);
-    // x6200_control_cmd(x6200_filter_ssb_2, val);
+    return ((uint32_t)(uint16_t)low << 16) | (uint16_t)high;
 }
 
-void set_rx_filters(uint32_t val)
+x6200_filter_group_t x6200_control_filter_group(x6200_mode_t mode)
 {
-    switch (vfo_modes[fg_vfo])
+    switch (mode)
     {
-    case x6200_mode_lsb:
-    case x6200_mode_lsb_dig:
-    case x6200_mode_usb:
-    case x6200_mode_usb_dig:
-        x6200_control_cmd(x6200_rxfilter, val);
-        x6200_control_cmd(x6200_filter_ssb, val);
-        break;
     case x6200_mode_cw:
     case x6200_mode_cwr:
-        x6200_control_cmd(x6200_rxfilter, val);
-        x6200_control_cmd(x6200_filter_cw, val);
-        break;
+        return X6200_FILTER_CW;
     case x6200_mode_am:
     case x6200_mode_sam:
-        x6200_control_cmd(x6200_rxfilter, val);
-        x6200_control_cmd(x6200_filter_am, val);
-        break;
+        return X6200_FILTER_AM;
     case x6200_mode_nfm:
-        x6200_control_cmd(x6200_rxfilter, val);
-        x6200_control_cmd(x6200_filter_nfm, val);
-        break;
+        return X6200_FILTER_NFM;
     case x6200_mode_wfm:
-        x6200_control_cmd(x6200_rxfilter, val);
-        x6200_control_cmd(x6200_filter_wfm, val);
-        break;
+        return X6200_FILTER_WFM;
 
     default:
-        break;
+        return X6200_FILTER_SSB;
     }
 }
 
+uint32_t x6200_control_filter_bank_packed(x6200_filter_group_t group)
+{
+    return x6200_control_get(filter_regs[group]);
+}
+
+void x6200_control_filter_bank_get(x6200_filter_group_t group, int16_t *low, int16_t *high)
+{
+    uint32_t val = x6200_control_filter_bank_packed(group);
+
+    *low = (int16_t)(val >> 16);
+    *high = (int16_t)(val & 0xFFFF);
+}
+
+void x6200_control_filter_bank_set(x6200_filter_group_t group, int16_t low, int16_t high)
+{
+    uint32_t val = filter_pack(low, high);
+
+    if (group != x6200_control_filter_group(vfo_mode(fg_vfo))) {
+        x6200_control_cmd(filter_regs[group], val);
+        return;
+    }
+
+    x6200_cmd_arg_t cmds[] = {
+        { x6200_rxfilter, val },
+        { filter_regs[group], val },
+    };
+
+    x6200_control_cmd_batch(cmds, 2);
+}
+
 void x6200_control_rx_filter_set(int16_t low, int16_t high)
 {
-    uint32_t val = (((uint32_t)low) << 16) | high;
-    set_rx_filters(val);
+    x6200_control_filter_bank_set(x6200_control_filter_group(vfo_mode(fg_vfo)), low, high);
 }
 
 void x6200_control_rx_filter_set_low(int16_t low)
 {
-    uint32_t val = x6200_control_get(x6200_rxfilter) & (0x0000FFFF);
-    val |= (((uint32_t)low) << 16);
-    set_rx_filters(val);
+    x6200_filter_group_t group = x6200_control_filter_group(vfo_mode(fg_vfo));
+    int16_t              prev_low, high;
+
+    x6200_control_filter_bank_get(group, &prev_low, &high);
+    x6200_control_filter_bank_set(group, low, high);
 }
 
 void x6200_control_rx_filter_set_high(int16_t high)
 {
-    uint32_t val = x6200_control_get(x6200_rxfilter) & (0xFFFF0000);
-    val |= high;
-    set_rx_filters(val);
+    x6200_filter_group_t group = x6200_control_filter_group(vfo_mode(fg_vfo));
+    int16_t              low, prev_high;
+
+    x6200_control_filter_bank_get(group, &low, &prev_high);
+    x6200_control_filter_bank_set(group, low, high);
 }
 
 /* Operation */
@@ -442,8 +570,14 @@ void x6200_control_vfo_set(x6200_vfo_t vfo) {
     fg_vfo = vfo;
 
     uint32_t prev = x6200_control_get(x6200_vi_vm) & (~(0xFF));
+    uint32_t filter = x6200_control_filter_bank_packed(x6200_control_filter_group(vfo_mode(vfo)));
+
+    x6200_cmd_arg_t cmds[] = {
+        { x6200_rxfilter, filter },
+        { x6200_vi_vm, prev | vfo },
+    };
 
-    x6200_control_cmd(x6200_vi_vm, prev | vfo);
+    x6200_control_cmd_batch(cmds, 2);
 }
 
 void x6200_control_vm_set(bool on) {
@@ -576,7 +710,30 @@ void x6200_control_comp_level_set(x6200_comp_level_t level)
     x6200_control_cmd(x6200_cmplevel_cmpe, prev | (level & 0xf));
 }
 
+/* EQ registers: 5 bands x 5 bits, enable at bit 25 */
+
+#define EQ_MASK 0x03FFFFFF
+
+static void eq_apply(x6200_cmd_enum_t cmd, bool on, const int8_t bands[5]) {
+    uint32_t prev = x6200_control_get(cmd);
+    uint32_t next = prev & (~EQ_MASK);
+
+    for (int i = 0; i < 5; i++) {
+        next |= (bands[i] & 0x1F) << (i * 5);
+    }
+    next |= on << 25;
+
+    /* Skip bus write, when nothing changed. Useful for presets morphing */
+    if (next != prev) {
+        x6200_control_cmd(cmd, next);
+    }
+}
+
 /* RX EQ */
+void x6200_control_rx_eq_apply(bool on, const int8_t bands[5]) {
+    eq_apply(x6200_rxeq, on, bands);
+}
+
 void x6200_control_rx_eq_set(bool on) {
     uint32_t prev = x6200_control_get(x6200_rxeq) & (~(1 << 25));
 
@@ -614,6 +771,10 @@ void x6200_control_rx_eq_p5_set(int8_t level) {
 }
 
 /* RX EQ WFM */
+void x6200_control_rx_eq_wfm_apply(bool on, const int8_t bands[5]) {
+    eq_apply(x6200_rxeqwfm, on, bands);
+}
+
 void x6200_control_rx_eq_wfm_set(bool on) {
     uint32_t prev = x6200_control_get(x6200_rxeqwfm) & (~(1 << 25));
 
@@ -651,6 +812,10 @@ void x6200_control_rx_eq_wfm_p5_set(int8_t level) {
 }
 
 /* MIC EQ */
+void x6200_control_mic_eq_apply(bool on, const int8_t bands[5]) {
+    eq_apply(x6200_miceq, on, bands);
+}
+
 void x6200_control_mic_eq_set(bool on) {
     uint32_t prev = x6200_control_get(x6200_miceq) & (~(1 << 25));
 
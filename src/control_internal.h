@@ -0,0 +1,23 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#pragma once
+
+#include "aether_radio/x6200_control/api.h"
+#include "aether_radio/x6200_control/low/control.h"
+
+/* Library internal part of control */
+
+/* Foreground VFO and VFO modes from the register mirror, after init pushed it */
+
+AETHER_X6200CTRL_NO_EXPORT void x6200_control_state_load();
+
+/* Mirror a value BASE already has, no transfer */
+
+AETHER_X6200CTRL_NO_EXPORT void x6200_control_mirror_set(x6200_cmd_enum_t cmd, uint32_t arg);
@@ -0,0 +1,410 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#include "aether_radio/x6200_control/keyer.h"
+#include "aether_radio/x6200_control/low/control.h"
+#include "aether_radio/x6200_control/low/gpio.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define QUEUE_SIZE  4096
+#define SLICE_NS    5000000
+#define KEY_DOWN    0
+#define KEY_UP      1
+
+static const char *morse[128] = {
+    ['A'] = ".-",       ['B'] = "-...",     ['C'] = "-.-.",     ['D'] = "-..",
+    ['E'] = ".",        ['F'] = "..-.",     ['G'] = "--.",      ['H'] = "....",
+    ['I'] = "..",       ['J'] = ".---",     ['K'] = "-.-",      ['L'] = ".-..",
+    ['M'] = "--",       ['N'] = "-.",       ['O'] = "---",      ['P'] = ".--.",
+    ['Q'] = "--.-",     ['R'] = ".-.",      ['S'] = "...",      ['T'] = "-",
+    ['U'] = "..-",      ['V'] = "...-",     ['W'] = ".--",      ['X'] = "-..-",
+    ['Y'] = "-.--",     ['Z'] = "--..",
+    ['0'] = "-----",    ['1'] = ".----",    ['2'] = "..---",    ['3'] = "...--",
+    ['4'] = "....-",    ['5'] = ".....",    ['6'] = "-....",    ['7'] = "--...",
+    ['8'] = "---..",    ['9'] = "----.",
+    ['.'] = ".-.-.-",   [','] = "--..--",   ['?'] = "..--..",   ['/'] = "-..-.",
+    ['='] = "-...-",    ['+'] = ".-.-.",    ['-'] = "-....-",   ['@'] = ".--.-.",
+    ['\''] = ".----.",  ['('] = "-.--.",    [')'] = "-.--.-",   [':'] = "---...",
+};
+
+static x6200_keyer_config_t conf;
+static pthread_t            thread;
+static pthread_mutex_t      mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t       cond;
+static bool                 running = false;
+static bool                 keying = false;
+static uint32_t             abort_gen = 0;
+
+static uint8_t              queue[QUEUE_SIZE];
+static size_t               queue_head = 0;
+static size_t               queue_len = 0;
+
+static x6200_keyer_stats_t  stats;
+static double               jitter_sum;
+
+static uint64_t ts_ns(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000000ull + ts->tv_nsec;
+}
+
+static struct timespec ns_ts(uint64_t ns)
+{
+    struct timespec ts = {
+        .tv_sec = ns / 1000000000ull,
+        .tv_nsec = ns % 1000000000ull,
+    };
+
+    return ts;
+}
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts_ns(&ts);
+}
+
+static bool aborted(uint32_t gen)
+{
+    pthread_mutex_lock(&mutex);
+    bool res = gen != abort_gen || !running;
+    pthread_mutex_unlock(&mutex);
+
+    return res;
+}
+
+/* Sleep until deadline in slices, so abort is seen within a slice. Last slice ends exactly on deadline */
+
+static bool sleep_until(uint64_t deadline, uint32_t gen)
+{
+    while (true) {
+        uint64_t now = now_ns();
+
+        if (aborted(gen)) {
+            return false;
+        }
+        if (now >= deadline) {
+            return true;
+        }
+
+        struct timespec ts = ns_ts(deadline - now > SLICE_NS ? now + SLICE_NS : deadline);
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+}
+
+static bool edge(int value, uint64_t deadline, uint32_t gen)
+{
+    if (!sleep_until(deadline, gen)) {
+        return false;
+    }
+
+    /* Checked and set under mutex, so abort can't slip between them and leave key down */
+
+    pthread_mutex_lock(&mutex);
+
+    if (gen != abort_gen || !running) {
+        pthread_mutex_unlock(&mutex);
+        return false;
+    }
+    x6200_gpio_set(x6200_pin_morse_key, value);
+
+    float jitter = (now_ns() - deadline) / 1000.0f;
+
+    stats.edges++;
+    stats.jitter_last_us = jitter;
+    jitter_sum += jitter;
+    stats.jitter_avg_us = jitter_sum / stats.edges;
+
+    if (jitter > stats.jitter_max_us) {
+        stats.jitter_max_us = jitter;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    return true;
+}
+
+static void timing(const x6200_keyer_config_t *c, uint64_t *dot, uint64_t *dash, int64_t *weight)
+{
+    uint8_t wpm = c->wpm;
+    float   ratio = c->ratio;
+    uint8_t w = c->weight ? c->weight : 50;
+
+    if (wpm == 0) {
+        wpm = x6200_control_get(x6200_ks_km_kimb_cwtone_cwvol_cwtrain) & 0xFF;
+    }
+    if (ratio == 0.0f) {
+        ratio = (x6200_control_get(x6200_qsktime_kr) >> 16) / 10.0f;
+    }
+    if (wpm == 0) {
+        wpm = 20;
+    }
+    if (ratio < 1.0f) {
+        ratio = 3.0f;
+    }
+
+    *dot = 1200000000ull / wpm;
+    *dash = *dot * ratio;
+    *weight = ((int64_t)w - 50) * (int64_t)*dot / 50;
+}
+
+static void *keyer_thread(void *arg)
+{
+    uint64_t next = 0;
+
+    (void)arg;
+
+    while (true) {
+        pthread_mutex_lock(&mutex);
+
+        while (running && queue_len == 0) {
+            keying = false;
+            pthread_cond_wait(&cond, &mutex);
+        }
+        if (!running) {
+            pthread_mutex_unlock(&mutex);
+            break;
+        }
+
+        x6200_keyer_element_t   el = queue[queue_head];
+        x6200_keyer_config_t    c = conf;
+        uint32_t                gen = abort_gen;
+
+        queue_head = (queue_head + 1) % QUEUE_SIZE;
+        queue_len--;
+        keying = true;
+        pthread_mutex_unlock(&mutex);
+
+        uint64_t    dot, dash;
+        int64_t     weight;
+        uint64_t    now = now_ns();
+
+        timing(&c, &dot, &dash, &weight);
+
+        /* Idle line: start from now, otherwise continue previous deadline chain */
+
+        if (next < now) {
+            next = now;
+        }
+
+        switch (el) {
+            case X6200_KEYER_DOT:
+            case X6200_KEYER_DASH: {
+                uint64_t mark = (el == X6200_KEYER_DOT ? dot : dash) + weight;
+
+                if (!edge(KEY_DOWN, next, gen)) {
+                    break;
+                }
+                next += mark;
+
+                if (!edge(KEY_UP, next, gen)) {
+                    break;
+                }
+                next += dot - weight;
+                break;
+            }
+
+            case X6200_KEYER_CHAR_SPACE:
+                next += 2 * dot;
+                break;
+
+            case X6200_KEYER_WORD_SPACE:
+                next += 4 * dot;
+                break;
+        }
+
+        /* Only this thread drives the line, abort is handled here */
+
+        if (aborted(gen)) {
+            x6200_gpio_set(x6200_pin_morse_key, KEY_UP);
+            next = 0;
+        }
+    }
+
+    x6200_gpio_set(x6200_pin_morse_key, KEY_UP);
+    return NULL;
+}
+
+bool x6200_keyer_start(const x6200_keyer_config_t *c)
+{
+    pthread_attr_t      attr;
+    pthread_condattr_t  cond_attr;
+
+    x6200_keyer_stop();
+
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    pthread_mutex_lock(&mutex);
+    conf = *c;
+    queue_len = 0;
+    running = true;
+    pthread_mutex_unlock(&mutex);
+
+    pthread_attr_init(&attr);
+
+    if (conf.priority > 0) {
+        struct sched_param param = { .sched_priority = conf.priority };
+
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    int res = pthread_create(&thread, &attr, keyer_thread, NULL);
+
+    if (res != 0 && conf.priority > 0) {
+        printf("Keyer: can't get real-time priority, normal thread is used\n");
+        res = pthread_create(&thread, NULL, keyer_thread, NULL);
+    }
+    pthread_attr_destroy(&attr);
+
+    if (res != 0) {
+        pthread_mutex_lock(&mutex);
+        running = false;
+        pthread_mutex_unlock(&mutex);
+
+        pthread_cond_destroy(&cond);
+        return false;
+    }
+    return true;
+}
+
+void x6200_keyer_stop()
+{
+    pthread_mutex_lock(&mutex);
+
+    if (!running) {
+        pthread_mutex_unlock(&mutex);
+        return;
+    }
+    running = false;
+    queue_len = 0;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+
+    pthread_join(thread, NULL);
+    pthread_cond_destroy(&cond);
+}
+
+void x6200_keyer_config_set(const x6200_keyer_config_t *c)
+{
+    pthread_mutex_lock(&mutex);
+    conf.wpm = c->wpm;
+    conf.weight = c->weight;
+    conf.ratio = c->ratio;
+    pthread_mutex_unlock(&mutex);
+}
+
+static bool queue_push(const uint8_t *elements, size_t count)
+{
+    pthread_mutex_lock(&mutex);
+
+    if (!running || queue_len + count > QUEUE_SIZE) {
+        pthread_mutex_unlock(&mutex);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        queue[(queue_head + queue_len) % QUEUE_SIZE] = elements[i];
+        queue_len++;
+    }
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+
+    return true;
+}
+
+bool x6200_keyer_send_elements(const x6200_keyer_element_t *elements, size_t count)
+{
+    uint8_t buf[QUEUE_SIZE];
+
+    if (count > QUEUE_SIZE) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        buf[i] = elements[i];
+    }
+    return queue_push(buf, count);
+}
+
+bool x6200_keyer_send_text(const char *text)
+{
+    uint8_t buf[QUEUE_SIZE];
+    size_t  count = 0;
+
+    for (const char *c = text; *c; c++) {
+        if (*c == ' ') {
+            if (count > 0 && buf[count - 1] == X6200_KEYER_CHAR_SPACE) {
+                if (count + 1 > QUEUE_SIZE) {
+                    return false;
+                }
+                buf[count++] = X6200_KEYER_WORD_SPACE;
+            }
+            continue;
+        }
+
+        int         ch = toupper((unsigned char)*c);
+        const char  *code = ch < 128 ? morse[ch] : NULL;
+
+        if (!code) {
+            continue;
+        }
+        if (count + strlen(code) + 1 > QUEUE_SIZE) {
+            return false;
+        }
+
+        for (; *code; code++) {
+            buf[count++] = *code == '.' ? X6200_KEYER_DOT : X6200_KEYER_DASH;
+        }
+        buf[count++] = X6200_KEYER_CHAR_SPACE;
+    }
+    return queue_push(buf, count);
+}
+
+void x6200_keyer_abort()
+{
+    pthread_mutex_lock(&mutex);
+    queue_len = 0;
+    abort_gen++;
+    pthread_mutex_unlock(&mutex);
+}
+
+bool x6200_keyer_busy()
+{
+    pthread_mutex_lock(&mutex);
+    bool busy = running && (keying || queue_len > 0);
+    pthread_mutex_unlock(&mutex);
+
+    return busy;
+}
+
+void x6200_keyer_stats(x6200_keyer_stats_t *s)
+{
+    pthread_mutex_lock(&mutex);
+    *s = stats;
+    pthread_mutex_unlock(&mutex);
+}
+
+void x6200_keyer_stats_reset()
+{
+    pthread_mutex_lock(&mutex);
+    memset(&stats, 0, sizeof(stats));
+    jitter_sum = 0.0;
+    pthread_mutex_unlock(&mutex);
+}
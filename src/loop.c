@@ -0,0 +1,445 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#include "aether_radio/x6200_control/loop.h"
+#include "aether_radio/x6200_control/low/control.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#define MAX_SOURCES 32
+#define MAX_EVENTS  16
+#define QUEUE_SIZE  64
+
+typedef enum {
+    SOURCE_FREE = 0,
+    SOURCE_FLOW,
+    SOURCE_FLOW_TIMEOUT,
+    SOURCE_KEEPALIVE,
+    SOURCE_CMD,
+    SOURCE_TIMER,
+    SOURCE_FD,
+} source_type_t;
+
+typedef struct {
+    source_type_t           type;
+    int                     fd;
+    bool                    repeat;
+    x6200_loop_timer_cb_t   timer_cb;
+    x6200_loop_fd_cb_t      fd_cb;
+    void                    *user;
+} source_t;
+
+typedef struct {
+    x6200_loop_cmd_cb_t cb;
+    void                *arg;
+} cmd_t;
+
+static x6200_loop_config_t  conf;
+static int                  epoll_fd = -1;
+static source_t             sources[MAX_SOURCES];
+static source_t             *flow_source;
+static source_t             *flow_timeout_source;
+static source_t             *cmd_source;
+static atomic_bool          running = false;
+
+static pthread_mutex_t      queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static cmd_t                queue[QUEUE_SIZE];
+static size_t               queue_head = 0;
+static size_t               queue_len = 0;
+
+static x6200_flow_flags_t   prev_flags;
+static bool                 prev_valid = false;
+
+static source_t *source_add(source_type_t type, int fd, uint32_t events)
+{
+    for (int i = 0; i < MAX_SOURCES; i++) {
+        source_t *s = &sources[i];
+
+        if (s->type != SOURCE_FREE) {
+            continue;
+        }
+
+        struct epoll_event ev = {
+            .events = events,
+            .data.ptr = s,
+        };
+
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("Can't add loop source");
+            return NULL;
+        }
+        memset(s, 0, sizeof(*s));
+        s->type = type;
+        s->fd = fd;
+
+        return s;
+    }
+    printf("Loop sources are over\n");
+    return NULL;
+}
+
+static void source_remove(source_t *s, bool close_fd)
+{
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, s->fd, NULL);
+
+    if (close_fd) {
+        close(s->fd);
+    }
+    s->type = SOURCE_FREE;
+}
+
+static bool timer_arm(int fd, uint32_t ms, bool repeat)
+{
+    struct itimerspec spec = { 0 };
+
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (ms % 1000) * 1000000;
+
+    if (repeat) {
+        spec.it_interval = spec.it_value;
+    }
+    return timerfd_settime(fd, 0, &spec, NULL) == 0;
+}
+
+static source_t *timer_source(source_type_t type, uint32_t ms, bool repeat)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (fd < 0) {
+        perror("Can't create timer");
+        return NULL;
+    }
+
+    source_t *s = source_add(type, fd, EPOLLIN);
+
+    if (!s) {
+        close(fd);
+        return NULL;
+    }
+    if (ms && !timer_arm(fd, ms, repeat)) {
+        source_remove(s, true);
+        return NULL;
+    }
+    s->repeat = repeat;
+    return s;
+}
+
+/* Handlers */
+
+static void handle_flow()
+{
+    x6200_flow_t pack;
+
+    while (x6200_flow_read(&pack)) {
+        if (flow_timeout_source) {
+            timer_arm(flow_timeout_source->fd, conf.flow_timeout_ms, false);
+        }
+
+        if (conf.flags && prev_valid && memcmp(&prev_flags, &pack.flag, sizeof(prev_flags)) != 0) {
+            conf.flags(prev_flags, pack.flag, conf.user);
+        }
+        prev_flags = pack.flag;
+        prev_valid = true;
+
+        if (conf.packet) {
+            conf.packet(&pack, conf.user);
+        }
+    }
+}
+
+static void handle_flow_timeout()
+{
+    printf("Flow timeout, restart\n");
+
+    if (flow_source) {
+        source_remove(flow_source, false);
+        flow_source = NULL;
+    }
+    prev_valid = false;
+
+    if (x6200_flow_restart()) {
+        flow_source = source_add(SOURCE_FLOW, x6200_flow_fd(), EPOLLIN);
+    }
+    timer_arm(flow_timeout_source->fd, conf.flow_timeout_ms, false);
+}
+
+static void handle_cmd()
+{
+    uint64_t val;
+
+    if (read(cmd_source->fd, &val, sizeof(val)) < 0) {
+        return;
+    }
+
+    while (true) {
+        pthread_mutex_lock(&queue_mutex);
+
+        if (queue_len == 0) {
+            pthread_mutex_unlock(&queue_mutex);
+            break;
+        }
+
+        cmd_t cmd = queue[queue_head];
+
+        queue_head = (queue_head + 1) % QUEUE_SIZE;
+        queue_len--;
+        pthread_mutex_unlock(&queue_mutex);
+
+        cmd.cb(cmd.arg);
+    }
+}
+
+static void handle(source_t *s, uint32_t events)
+{
+    uint64_t expirations;
+
+    switch (s->type) {
+        case SOURCE_FLOW:
+            handle_flow();
+            break;
+
+        case SOURCE_FLOW_TIMEOUT:
+            if (read(s->fd, &expirations, sizeof(expirations)) > 0) {
+                handle_flow_timeout();
+            }
+            break;
+
+        case SOURCE_KEEPALIVE:
+            if (read(s->fd, &expirations, sizeof(expirations)) > 0) {
+                x6200_control_idle();
+
+                if (conf.keepalive) {
+                    conf.keepalive(conf.user);
+                }
+            }
+            break;
+
+        case SOURCE_CMD:
+            handle_cmd();
+            break;
+
+        case SOURCE_TIMER:
+            if (read(s->fd, &expirations, sizeof(expirations)) > 0) {
+                x6200_loop_timer_cb_t   cb = s->timer_cb;
+                void                    *user = s->user;
+
+                if (!s->repeat) {
+                    source_remove(s, true);
+                }
+                cb(user);
+            }
+            break;
+
+        case SOURCE_FD:
+            s->fd_cb(s->fd, events, s->user);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* API */
+
+bool x6200_loop_init(const x6200_loop_config_t *c)
+{
+    x6200_loop_close();
+
+    conf = *c;
+
+    if (conf.keepalive_ms == 0) {
+        conf.keepalive_ms = X6200_REFRASH_TIMEOUT;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (epoll_fd < 0) {
+        perror("Can't create epoll");
+        return false;
+    }
+    memset(sources, 0, sizeof(sources));
+
+    flow_source = source_add(SOURCE_FLOW, x6200_flow_fd(), EPOLLIN);
+
+    int cmd_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    cmd_source = cmd_fd < 0 ? NULL : source_add(SOURCE_CMD, cmd_fd, EPOLLIN);
+
+    if (!flow_source || !cmd_source || !timer_source(SOURCE_KEEPALIVE, conf.keepalive_ms, true)) {
+        x6200_loop_close();
+        return false;
+    }
+
+    if (conf.flow_timeout_ms) {
+        flow_timeout_source = timer_source(SOURCE_FLOW_TIMEOUT, conf.flow_timeout_ms, false);
+
+        if (!flow_timeout_source) {
+            x6200_loop_close();
+            return false;
+        }
+    }
+    prev_valid = false;
+    queue_len = 0;
+
+    return true;
+}
+
+void x6200_loop_close()
+{
+    if (epoll_fd < 0) {
+        return;
+    }
+
+    for (int i = 0; i < MAX_SOURCES; i++) {
+        source_t *s = &sources[i];
+
+        if (s->type != SOURCE_FREE) {
+            source_remove(s, s->type != SOURCE_FLOW && s->type != SOURCE_FD);
+        }
+    }
+    close(epoll_fd);
+
+    epoll_fd = -1;
+    flow_source = NULL;
+    flow_timeout_source = NULL;
+    cmd_source = NULL;
+}
+
+bool x6200_loop_run_once(int timeout_ms)
+{
+    struct epoll_event events[MAX_EVENTS];
+
+    int n = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout_ms);
+
+    if (n < 0) {
+        return false;
+    }
+
+    for (int i = 0; i < n; i++) {
+        source_t *s = events[i].data.ptr;
+
+        if (s->type != SOURCE_FREE) {
+            handle(s, events[i].events);
+        }
+    }
+    return true;
+}
+
+void x6200_loop_run()
+{
+    atomic_store(&running, true);
+
+    while (atomic_load(&running)) {
+        x6200_loop_run_once(-1);
+    }
+}
+
+void x6200_loop_stop()
+{
+    uint64_t val = 1;
+
+    atomic_store(&running, false);
+
+    if (cmd_source) {
+        write(cmd_source->fd, &val, sizeof(val));
+    }
+}
+
+bool x6200_loop_post(x6200_loop_cmd_cb_t cb, void *arg)
+{
+    uint64_t val = 1;
+
+    pthread_mutex_lock(&queue_mutex);
+
+    if (queue_len == QUEUE_SIZE || !cmd_source) {
+        pthread_mutex_unlock(&queue_mutex);
+        return false;
+    }
+    queue[(queue_head + queue_len) % QUEUE_SIZE] = (cmd_t) { cb, arg };
+    queue_len++;
+    pthread_mutex_unlock(&queue_mutex);
+
+    return write(cmd_source->fd, &val, sizeof(val)) == sizeof(val);
+}
+
+bool x6200_loop_fd_add(int fd, uint32_t events, x6200_loop_fd_cb_t cb, void *user)
+{
+    source_t *s = source_add(SOURCE_FD, fd, events);
+
+    if (!s) {
+        return false;
+    }
+    s->fd_cb = cb;
+    s->user = user;
+
+    return true;
+}
+
+bool x6200_loop_fd_remove(int fd)
+{
+    for (int i = 0; i < MAX_SOURCES; i++) {
+        source_t *s = &sources[i];
+
+        if (s->type == SOURCE_FD && s->fd == fd) {
+            source_remove(s, false);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool x6200_loop_fd_modify(int fd, uint32_t events)
+{
+    for (int i = 0; i < MAX_SOURCES; i++) {
+        source_t *s = &sources[i];
+
+        if (s->type == SOURCE_FD && s->fd == fd) {
+            struct epoll_event ev = {
+                .events = events,
+                .data.ptr = s,
+            };
+
+            return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0;
+        }
+    }
+    return false;
+}
+
+int x6200_loop_timer_add(uint32_t period_ms, bool repeat, x6200_loop_timer_cb_t cb, void *user)
+{
+    if (period_ms == 0) {
+        return -1;
+    }
+
+    source_t *s = timer_source(SOURCE_TIMER, period_ms, repeat);
+
+    if (!s) {
+        return -1;
+    }
+    s->timer_cb = cb;
+    s->user = user;
+
+    return s - sources;
+}
+
+bool x6200_loop_timer_remove(int id)
+{
+    if (id < 0 || id >= MAX_SOURCES || sources[id].type != SOURCE_TIMER) {
+        return false;
+    }
+    source_remove(&sources[id], true);
+    return true;
+}
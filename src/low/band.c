@@ -0,0 +1,145 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#include "aether_radio/x6200_control/low/control.h"
+
+#include <pthread.h>
+#include <string.h>
+
+/*
+ * Band index:
+ *   0      - below first band
+ *   2n + 1 - inside band n (edges are inclusive)
+ *   2n + 2 - between band n and n + 1, or above the last one
+ */
+
+/* ITU allocations. Region 2 keeps the edges of the old if-chain and is the default */
+
+static const x6200_band_t region_1[] = {
+    { 1810000,  2000000 },
+    { 3500000,  3800000 },
+    { 5351500,  5366500 },
+    { 7000000,  7200000 },
+    { 10100000, 10150000 },
+    { 14000000, 14350000 },
+    { 18068000, 18168000 },
+    { 21000000, 21450000 },
+    { 24890000, 24990000 },
+    { 28000000, 29700000 },
+    { 50000000, 54000000 },
+};
+
+static const x6200_band_t region_2[] = {
+    { 1800000,  2000000 },
+    { 3500000,  4000000 },
+    { 5330500,  5405000 },
+    { 7000000,  7300000 },
+    { 10100000, 10150000 },
+    { 14000000, 14350000 },
+    { 18068000, 18168000 },
+    { 21000000, 21450000 },
+    { 24890000, 24990000 },
+    { 28000000, 29700000 },
+    { 50000000, 54000000 },
+};
+
+static const x6200_band_t region_3[] = {
+    { 1800000,  2000000 },
+    { 3500000,  3900000 },
+    { 5351500,  5366500 },
+    { 7000000,  7200000 },
+    { 10100000, 10150000 },
+    { 14000000, 14350000 },
+    { 18068000, 18168000 },
+    { 21000000, 21450000 },
+    { 24890000, 24990000 },
+    { 28000000, 29700000 },
+    { 50000000, 54000000 },
+};
+
+static x6200_band_t     plan[X6200_BAND_PLAN_MAX];
+static size_t           plan_count = 0;
+static pthread_rwlock_t plan_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+bool x6200_control_band_plan_set(const x6200_band_t *bands, size_t count)
+{
+    if (count == 0 || count > X6200_BAND_PLAN_MAX) {
+        return false;
+    }
+
+    /* Sorted, not overlapped */
+
+    for (size_t i = 0; i < count; i++) {
+        if (bands[i].start > bands[i].end) {
+            return false;
+        }
+        if (i > 0 && bands[i].start <= bands[i - 1].end) {
+            return false;
+        }
+    }
+
+    pthread_rwlock_wrlock(&plan_lock);
+    memcpy(plan, bands, count * sizeof(x6200_band_t));
+    plan_count = count;
+    pthread_rwlock_unlock(&plan_lock);
+
+    return true;
+}
+
+bool x6200_control_band_plan_region(x6200_region_t region)
+{
+    switch (region)
+    {
+    case x6200_region_1:
+        return x6200_control_band_plan_set(region_1, sizeof(region_1) / sizeof(region_1[0]));
+    case x6200_region_2:
+        return x6200_control_band_plan_set(region_2, sizeof(region_2) / sizeof(region_2[0]));
+    case x6200_region_3:
+        return x6200_control_band_plan_set(region_3, sizeof(region_3) / sizeof(region_3[0]));
+
+    default:
+        return false;
+    }
+}
+
+uint8_t x6200_control_band_index(uint32_t freq)
+{
+    pthread_rwlock_rdlock(&plan_lock);
+
+    const x6200_band_t  *bands = plan_count ? plan : region_2;
+    size_t              count = plan_count ? plan_count : sizeof(region_2) / sizeof(region_2[0]);
+
+    /* Last band with start <= freq */
+
+    size_t lo = 0;
+    size_t hi = count;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+
+        if (bands[mid].start <= freq) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    uint8_t index;
+
+    if (lo == 0) {
+        index = 0;
+    } else if (freq <= bands[lo - 1].end) {
+        index = 2 * (lo - 1) + 1;
+    } else {
+        index = 2 * (lo - 1) + 2;
+    }
+
+    pthread_rwlock_unlock(&plan_lock);
+    return index;
+}
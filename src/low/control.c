@@ -8,18 +8,32 @@
  */
 
 #include "aether_radio/x6200_control/low/control.h"
+#include "aether_radio/x6200_control/low/transport.h"
+#include "trace_internal.h"
+#include "../control_internal.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <linux/i2c-dev.h>
 #include <linux/i2c.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
-#define REFRASH_TIMEOUT (1 * 1000)
+#define CACHE_MAGIC     0x58364301
+#define FW_VERSION_ADDR 0x41
+#define FW_VERSION_LEN  0x20
+
+#define READY_POLL_MIN  1000        /* us */
+#define READY_POLL_MAX  100000      /* us */
 
 typedef struct __attribute__((__packed__))
 {
@@ -33,10 +47,12 @@ typedef struct __attribute__((__packed__))
     uint32_t arg[x6200_last + 1];
 } all_cmd_struct_t;
 
+static const x6200_i2c_transport_t *i2c = NULL;
 static int i2c_fd = -1;
 static int i2c_addr = 0x72;
 static all_cmd_struct_t all_cmd;
 static uint8_t cur_band = 0;
+static uint16_t sync_addr = 0;          /* Register file read address, not known on hardware */
 
 static char base_info[129];
 static char calibration_data[507];
@@ -45,31 +61,295 @@ static char *ver2 = base_info + 0x21;
 static char *base_fw_version = base_info + 0x41;
 static char *base_fw_date = base_info + 0x61;
 
+_Static_assert(sizeof(x6200_calibration_t) == sizeof(calibration_data), "Calibration size mismatch");
+
+static x6200_base_info_t    base_info_parsed;
+static bool                 base_info_valid = false;
+static pthread_mutex_t      base_info_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Warm start cache, mapped from file */
+
+typedef struct __attribute__((__packed__))
+{
+    uint32_t magic;
+    char     fw_version[FW_VERSION_LEN];
+    char     base_info[sizeof(base_info)];
+    char     calibration_data[sizeof(calibration_data)];
+    uint8_t  mirror_valid;
+    uint32_t arg[x6200_last + 1];
+} cache_t;
+
+static cache_t *cache = NULL;
+
+/* Bus retry policy and circuit breaker */
+
+typedef enum
+{
+    BREAKER_CLOSED = 0,
+    BREAKER_OPEN,
+} breaker_state_t;
+
+static x6200_control_retry_t retry = {
+    .retries = 2,
+    .backoff_us = 200,
+    .backoff_max_us = 5000,
+    .breaker_failures = 8,
+    .breaker_cooldown_ms = 500,
+};
+
+static pthread_mutex_t              bus_mutex = PTHREAD_MUTEX_INITIALIZER;
+static x6200_control_bus_stats_t    bus_stats;
+static breaker_state_t              breaker = BREAKER_CLOSED;
+static uint32_t                     breaker_fails = 0;
+static double                       breaker_time;
+static uint32_t                     jitter_seed = 0x2545F491;
+static x6200_control_attempt_cb_t   attempt_cb = NULL;
+static void                         *attempt_cb_user = NULL;
+
+/* Init */
+
+static pthread_mutex_t              init_mutex = PTHREAD_MUTEX_INITIALIZER;
+static x6200_control_init_stats_t   init_stats;
+static pthread_t                    init_thread;
+static bool                         init_started = false;
+static uint32_t                     init_timeout = 0;
+
+/* Kernel backend */
+
+static bool kernel_i2c_open()
+{
+    const char *dev = getenv("X6200_I2C_DEV");
+
+    i2c_fd = open(dev ? dev : "/dev/i2c-0", O_RDWR);
+    return i2c_fd >= 0;
+}
+
+static void kernel_i2c_close()
+{
+    if (close(i2c_fd) < 0) {
+        perror("Can't close i2c");
+    }
+    i2c_fd = -1;
+}
+
+static bool kernel_i2c_transfer(struct i2c_msg *messages, uint32_t nmsgs)
+{
+    struct i2c_rdwr_ioctl_data packets = {
+        .msgs = messages,
+        .nmsgs = nmsgs,
+    };
+
+    return ioctl(i2c_fd, I2C_RDWR, &packets) >= 0;
+}
+
+const x6200_i2c_transport_t x6200_i2c_kernel = {
+    .name = "kernel",
+    .open = kernel_i2c_open,
+    .close = kernel_i2c_close,
+    .transfer = kernel_i2c_transfer,
+};
+
 static bool i2c_open()
 {
-    i2c_fd = open("/dev/i2c-0", O_RDWR);
-    if (i2c_fd < 0) {
+    const x6200_i2c_transport_t *transport = x6200_transport_i2c();
+    const char                  *addr = getenv("X6200_I2C_ADDR");
+
+    if (addr) {
+        i2c_addr = strtol(addr, NULL, 0);
+    }
+    if (!transport->open()) {
         perror("Can't open i2c");
         return false;
     }
+    i2c = transport;
     return true;
 }
 
 static void i2c_close()
 {
-    if (i2c_fd < 0) {
+    if (!i2c) {
         printf("Can't close i2c, not opened\n");
         return;
     }
-    if (close(i2c_fd) < 0) {
-        perror("Can't close i2c");
+    i2c->close();
+    i2c = NULL;
+}
+
+static double now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static bool transfer_raw(struct i2c_msg *messages, uint32_t nmsgs)
+{
+    if (!x6200_trace_active()) {
+        return i2c->transfer(messages, nmsgs);
     }
-    i2c_fd = -1;
+
+    uint64_t start = x6200_trace_now();
+    bool     ok = i2c->transfer(messages, nmsgs);
+    int      err = ok ? 0 : errno;
+
+    x6200_trace_record(start, messages, nmsgs, ok, err);
+    errno = err;
+
+    return ok;
+}
+
+static uint32_t backoff_delay(uint8_t attempt)
+{
+    /* backoff_us is 16 bit, so up to 16 doublings fit. Later ones are over the cap anyway */
+
+    uint32_t delay = (uint32_t)retry.backoff_us << (attempt < 16 ? attempt : 16);
+
+    if (delay > retry.backoff_max_us) {
+        delay = retry.backoff_max_us;
+    }
+
+    /* Jitter: random value in [delay / 2, delay] */
+
+    jitter_seed ^= jitter_seed << 13;
+    jitter_seed ^= jitter_seed >> 17;
+    jitter_seed ^= jitter_seed << 5;
+
+    return delay / 2 + jitter_seed % (delay / 2 + 1);
+}
+
+static bool push_mirror_raw()
+{
+    struct i2c_msg messages[] = {
+        {
+            .addr = i2c_addr,
+            .flags = 0,
+            .buf = (uint8_t *)&all_cmd,
+            .len = sizeof(all_cmd),
+        }
+    };
+
+    return transfer_raw(messages, 1);
+}
+
+static bool transfer(struct i2c_msg *messages, uint32_t nmsgs)
+{
+    bool ok = false;
+    int  err = 0;
+
+    pthread_mutex_lock(&bus_mutex);
+    bus_stats.transfers++;
+
+    /* Breaker is open - don't touch the bus until cooldown is over, then try once */
+
+    bool probe = false;
+
+    if (breaker == BREAKER_OPEN) {
+        if (now_ms() - breaker_time < retry.breaker_cooldown_ms) {
+            bus_stats.lost++;
+            pthread_mutex_unlock(&bus_mutex);
+            errno = EAGAIN;
+            return false;
+        }
+        probe = true;
+    }
+
+    uint8_t attempts = probe ? 1 : retry.retries + 1;
+
+    for (uint8_t attempt = 0; attempt < attempts; attempt++) {
+        if (attempt > 0) {
+            usleep(backoff_delay(attempt - 1));
+        }
+
+        double start = now_ms();
+
+        ok = transfer_raw(messages, nmsgs);
+        err = ok ? 0 : errno;
+
+        float latency = (now_ms() - start) * 1000.0f;
+
+        bus_stats.attempts++;
+        bus_stats.last_latency_us = latency;
+
+        if (latency > bus_stats.max_latency_us) {
+            bus_stats.max_latency_us = latency;
+        }
+        if (attempt_cb) {
+            attempt_cb(attempt, ok, err, latency, attempt_cb_user);
+        }
+        if (ok) {
+            if (attempt > 0) {
+                bus_stats.recovered++;
+            }
+            break;
+        }
+        bus_stats.failures++;
+    }
+
+    if (ok) {
+        breaker_fails = 0;
+
+        if (probe) {
+            /* Writes were dropped while the breaker was open. Keep it open until they are on BASE */
+            if (push_mirror_raw()) {
+                breaker = BREAKER_CLOSED;
+                bus_stats.breaker_open = false;
+            } else {
+                bus_stats.failures++;
+                breaker_time = now_ms();
+            }
+        }
+    } else {
+        bus_stats.lost++;
+        breaker_fails++;
+
+        if (probe || (retry.breaker_failures > 0 && breaker_fails >= retry.breaker_failures)) {
+            if (breaker != BREAKER_OPEN) {
+                bus_stats.breaker_trips++;
+            }
+            breaker = BREAKER_OPEN;
+            bus_stats.breaker_open = true;
+            breaker_time = now_ms();
+        }
+    }
+
+    pthread_mutex_unlock(&bus_mutex);
+    errno = err;
+    return ok;
+}
+
+void x6200_control_retry_set(const x6200_control_retry_t *policy)
+{
+    pthread_mutex_lock(&bus_mutex);
+    retry = *policy;
+    pthread_mutex_unlock(&bus_mutex);
+}
+
+void x6200_control_retry_get(x6200_control_retry_t *policy)
+{
+    pthread_mutex_lock(&bus_mutex);
+    *policy = retry;
+    pthread_mutex_unlock(&bus_mutex);
+}
+
+void x6200_control_attempt_cb_set(x6200_control_attempt_cb_t cb, void *user)
+{
+    pthread_mutex_lock(&bus_mutex);
+    attempt_cb = cb;
+    attempt_cb_user = user;
+    pthread_mutex_unlock(&bus_mutex);
+}
+
+void x6200_control_bus_stats(x6200_control_bus_stats_t *stats)
+{
+    pthread_mutex_lock(&bus_mutex);
+    *stats = bus_stats;
+    pthread_mutex_unlock(&bus_mutex);
 }
 
 static bool send_regs(void *regs, size_t size)
 {
-    if (i2c_fd < 0) {
+    if (!i2c) {
         printf("Can't write to i2c, not opened\n");
         return false;
     }
@@ -81,21 +361,16 @@ static bool send_regs(void *regs, size_t size)
             .len = size,
         }
     };
-    struct i2c_rdwr_ioctl_data packets = {
-        .msgs = messages,
-        .nmsgs = 1,
-    };
 
-    if(ioctl(i2c_fd, I2C_RDWR, &packets) < 0) {
+    if (!transfer(messages, 1)) {
         perror("Can't write to i2c");
         return false;
     }
     return true;
 }
 
-static bool get_regs(uint16_t reg, void *buf, uint16_t cnt) {
-    if (i2c_fd < 0) {
-        printf("Can't read from i2c, not opened");
+static bool read_regs(uint16_t reg, void *buf, uint16_t cnt, bool policy) {
+    if (!i2c) {
         return false;
     }
     reg = (reg & 0xFF) << 8 | (reg >> 8);
@@ -104,7 +379,7 @@ static bool get_regs(uint16_t reg, void *buf, uint16_t cnt) {
             .addr  = i2c_addr,
             .flags = 0,
             .len = 2,
-            .buf = (char*)&reg,
+            .buf = (uint8_t*)&reg,
         },
         {
             .addr  = i2c_addr,
@@ -114,52 +389,306 @@ static bool get_regs(uint16_t reg, void *buf, uint16_t cnt) {
         }
     };
 
-    struct i2c_rdwr_ioctl_data packets = {
-        .msgs      = messages,
-        .nmsgs     = 2,
-    };
+    if (policy) {
+        return transfer(messages, 2);
+    }
+
+    /* Tracer is shared with setters, so raw reads are serialized too */
+
+    pthread_mutex_lock(&bus_mutex);
+    bool ok = transfer_raw(messages, 2);
+    int  err = errno;
+    pthread_mutex_unlock(&bus_mutex);
+
+    errno = err;
+    return ok;
+}
 
-    if(ioctl(i2c_fd, I2C_RDWR, &packets) < 0) {
+static bool get_regs(uint16_t reg, void *buf, uint16_t cnt) {
+    if (!i2c) {
+        printf("Can't read from i2c, not opened");
+        return false;
+    }
+    if (!read_regs(reg, buf, cnt, true)) {
         perror("Can't read from i2c");
         return false;
     }
     return true;
 }
 
+/* Warm start cache */
+
+bool x6200_control_cache_open(const char *path)
+{
+    x6200_control_cache_close();
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0) {
+        perror("Can't open control cache");
+        return false;
+    }
+    if (ftruncate(fd, sizeof(cache_t)) < 0) {
+        perror("Can't resize control cache");
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, sizeof(cache_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        perror("Can't map control cache");
+        return false;
+    }
+    cache = map;
+
+    if (cache->magic != CACHE_MAGIC) {
+        memset(cache, 0, sizeof(cache_t));
+    }
+    return true;
+}
+
+void x6200_control_cache_close()
+{
+    if (cache) {
+        msync(cache, sizeof(cache_t), MS_ASYNC);
+        munmap(cache, sizeof(cache_t));
+        cache = NULL;
+    }
+}
+
+static void cache_commit(x6200_cmd_enum_t cmd, uint32_t arg)
+{
+    if (cache && cache->mirror_valid) {
+        cache->arg[cmd] = arg;
+    }
+}
+
+static void cache_commit_all()
+{
+    if (cache && cache->magic == CACHE_MAGIC) {
+        memcpy(cache->arg, all_cmd.arg, sizeof(cache->arg));
+        cache->mirror_valid = 1;
+    }
+}
+
+static bool cache_match()
+{
+    char fw_version[FW_VERSION_LEN];
+
+    return cache && cache->magic == CACHE_MAGIC &&
+           get_regs(FW_VERSION_ADDR, fw_version, sizeof(fw_version)) &&
+           memcmp(fw_version, cache->fw_version, sizeof(fw_version)) == 0;
+}
+
+static void cache_store_base()
+{
+    if (cache) {
+        if (cache->magic != CACHE_MAGIC ||
+            memcmp(cache->fw_version, base_info + FW_VERSION_ADDR, sizeof(cache->fw_version)) != 0)
+        {
+            cache->mirror_valid = 0;
+        }
+        cache->magic = CACHE_MAGIC;
+        memcpy(cache->fw_version, base_info + FW_VERSION_ADDR, sizeof(cache->fw_version));
+        memcpy(cache->base_info, base_info, sizeof(base_info));
+        memcpy(cache->calibration_data, calibration_data, sizeof(calibration_data));
+    }
+}
+
+static void copy_version(char *dst, const char *src)
+{
+    memcpy(dst, src, 32);
+    dst[32] = '\0';
+}
+
+static void parse_base_info()
+{
+    copy_version(base_info_parsed.fpga_version, ver1);
+    copy_version(base_info_parsed.hw_version, ver2);
+    copy_version(base_info_parsed.fw_version, base_fw_version);
+    copy_version(base_info_parsed.fw_date, base_fw_date);
+    base_info_valid = true;
+}
+
+/* Poll readiness with growing interval. timeout_ms = 0 - wait forever */
+
+static bool wait_ready(uint32_t timeout_ms, uint32_t *polls)
+{
+    double      start = now_ms();
+    uint32_t    delay = READY_POLL_MIN;
+    int         reported = -1;
+    uint8_t     val;
+
+    *polls = 0;
+
+    while (true) {
+        /* Not ready BASE is not a bus fault, so no retry policy here */
+        bool connected = read_regs(0x2000, &val, 1, false);
+
+        (*polls)++;
+
+        if (connected && val != 0) {
+            return true;
+        }
+
+        if (reported != connected) {
+            printf(connected ? "BASE is not ready, waiting\n" : "Can't connect BASE, waiting\n");
+            reported = connected;
+        }
+
+        if (timeout_ms > 0 && now_ms() - start >= timeout_ms) {
+            printf("BASE is not ready after %u ms\n", timeout_ms);
+            return false;
+        }
+
+        usleep(delay);
+
+        if (delay < READY_POLL_MAX) {
+            delay *= 2;
+
+            if (delay > READY_POLL_MAX) {
+                delay = READY_POLL_MAX;
+            }
+        }
+    }
+}
+
+static void *init_thread_fn(void *arg)
+{
+    (void)arg;
+
+    return (void *)(intptr_t)x6200_control_init_timeout(init_timeout);
+}
+
+bool x6200_control_init_start(uint32_t timeout_ms)
+{
+    pthread_mutex_lock(&init_mutex);
+
+    /* One bring-up at a time, previous one must be waited */
+
+    if (init_started) {
+        pthread_mutex_unlock(&init_mutex);
+        fprintf(stderr, "Control init is already running\n");
+        errno = EBUSY;
+        return false;
+    }
+
+    init_timeout = timeout_ms;
+
+    if (pthread_create(&init_thread, NULL, init_thread_fn, NULL) != 0) {
+        pthread_mutex_unlock(&init_mutex);
+        perror("Can't start control init");
+        return false;
+    }
+    init_started = true;
+    pthread_mutex_unlock(&init_mutex);
+
+    return true;
+}
+
+bool x6200_control_init_wait()
+{
+    pthread_mutex_lock(&init_mutex);
+
+    if (!init_started) {
+        pthread_mutex_unlock(&init_mutex);
+        return false;
+    }
+
+    pthread_t thread = init_thread;
+
+    init_started = false;
+    pthread_mutex_unlock(&init_mutex);
+
+    void *result;
+
+    pthread_join(thread, &result);
+
+    return (intptr_t)result != 0;
+}
+
+void x6200_control_init_stats(x6200_control_init_stats_t *stats)
+{
+    pthread_mutex_lock(&init_mutex);
+    *stats = init_stats;
+    pthread_mutex_unlock(&init_mutex);
+}
+
 bool x6200_control_init()
 {
+    return x6200_control_init_timeout(0);
+}
+
+static bool init_run(uint32_t timeout_ms, x6200_control_init_stats_t *stats)
+{
+    double start = now_ms();
+    double t = start;
+
+    if (getenv("X6200_TRACE")) {
+        x6200_trace_enable(true);
+    }
+
     if(!i2c_open()) {
         return false;
     }
     memset(&all_cmd, 0, sizeof(all_cmd));
 
-    uint8_t val;
-    while (true) {
-        if (!get_regs(0x2000, &val, 1)) {
-            printf("Can't connect BASE, retry after 1s\n");
-            usleep(1000000);
-        } else if (val == 0) {
-            printf("BASE is not ready, retry after 1s\n");
-            usleep(1000000);
-        } else {
-            break;
-        }
+    stats->open_ms = now_ms() - t;
+    t = now_ms();
+
+    if (!wait_ready(timeout_ms, &stats->ready_polls)) {
+        return false;
     }
 
-    if (!get_regs(0, base_info, sizeof(base_info))) {
+    stats->ready_ms = now_ms() - t;
+    t = now_ms();
+
+    /* Same firmware - base info and calibration are taken from cache */
+
+    char info[sizeof(base_info)];
+    char calibration[sizeof(calibration_data)];
+
+    stats->warm = cache_match();
+
+    if (stats->warm) {
+        memcpy(info, cache->base_info, sizeof(info));
+    } else if (!get_regs(0, info, sizeof(info))) {
         printf("Can't read BASE info\n");
         return false;
     }
-    printf("BASE ver1: %s\n", ver1);  // FPGA
-    printf("BASE ver2: %s\n", ver2);  // HW?
-    printf("BASE fw version: %s\n", base_fw_version);
-    printf("BASE fw date: %s\n", base_fw_date);
 
-    if (!get_regs(0x100, calibration_data, sizeof(calibration_data))) {
+    stats->base_info_ms = now_ms() - t;
+    t = now_ms();
+
+    if (stats->warm) {
+        memcpy(calibration, cache->calibration_data, sizeof(calibration));
+    } else if (!get_regs(0x100, calibration, sizeof(calibration))) {
         printf("Can't read BASE calibration data\n");
         return false;
     }
 
+    stats->calibration_ms = now_ms() - t;
+
+    pthread_mutex_lock(&base_info_mutex);
+    memcpy(base_info, info, sizeof(base_info));
+    memcpy(calibration_data, calibration, sizeof(calibration_data));
+    parse_base_info();
+
+    if (!stats->warm) {
+        cache_store_base();
+    }
+
+    /* Log goes to stderr, so init from a background thread doesn't mix with application output */
+
+    fprintf(stderr, "BASE ver1: %s\n", base_info_parsed.fpga_version);
+    fprintf(stderr, "BASE ver2: %s\n", base_info_parsed.hw_version);
+    fprintf(stderr, "BASE fw version: %s\n", base_info_parsed.fw_version);
+    fprintf(stderr, "BASE fw date: %s\n", base_info_parsed.fw_date);
+    pthread_mutex_unlock(&base_info_mutex);
+
     // // Copy from captures OEM
     // x6200_control_cmd(x6200_vi_vm, 0x00000000);
     // x6200_control_cmd(x6200_vfoa_freq, 0x00d81080);
@@ -218,6 +747,8 @@ bool x6200_control_init()
     // send_regs(calib_data_req, sizeof(calib_data_req));
 
     // Send host_cmd
+    t = now_ms();
+
     if (!x6200_control_host_cmd(0x8003)) {
         printf("Can't send host_cmd 0x8003\n");
         return false;
@@ -227,6 +758,8 @@ bool x6200_control_init()
         return false;
     }
 
+    stats->host_cmd_ms = now_ms() - t;
+
     // x6200_control_cmd(x6200_vi_vm, 0x00000000);
     // x6200_control_cmd(x6200_sple_atue_trx, 0x00000000);
     // x6200_control_cmd(x6200_vfoa_freq, 0x00d81080);
@@ -325,17 +858,19 @@ bool x6200_control_init()
     // x6200_control_cmd(x6200_miceq, 0x00000000);
 
 
-    // 0bb8 - 3000, 012c - 300
-    all_cmd.arg[x6200_filter_ssb] = 0xb80b2c01;
-    all_cmd.arg[x6200_filter_ssb_2] = 0xb80b2c01;
-    // 0320 - 800
-    all_cmd.arg[x6200_filter_cw] = 0x2003fce0;
-    // 1707 - 6000
-    all_cmd.arg[x6200_filter_am] = 0x7017e890;
-    // 2328 - 9000
-    all_cmd.arg[x6200_filter_nfm] = 0x2823dcd8;
-    // 3e80 - 16000
-    all_cmd.arg[x6200_filter_wfm] = 0x803ec180;
+    // Same packing as OEM captures: low << 16 | high
+    // 012c - 300, 0bb8 - 3000
+    all_cmd.arg[x6200_filter_ssb] = 0x012c0bb8;
+    all_cmd.arg[x6200_filter_ssb_2] = 0x012c0bb8;
+    // fce0 - -800, 0320 - 800
+    all_cmd.arg[x6200_filter_cw] = 0xfce00320;
+    // e890 - -6000, 1770 - 6000
+    all_cmd.arg[x6200_filter_am] = 0xe8901770;
+    // dcd8 - -9000, 2328 - 9000
+    all_cmd.arg[x6200_filter_nfm] = 0xdcd82328;
+    // c180 - -16000, 3e80 - 16000
+    all_cmd.arg[x6200_filter_wfm] = 0xc1803e80;
+    all_cmd.arg[x6200_rxfilter] = all_cmd.arg[x6200_filter_ssb];
 
     // // "[INFO] Baseband is ready"
     // // "160m 1800000  - 2000000"
@@ -422,15 +957,55 @@ bool x6200_control_init()
     // all_cmd.arg[x6200_pwrsync] = 2000000;
     // all_cmd.arg[x6200_last] = 0x100001;
 
+    if (cache && cache->mirror_valid) {
+        memcpy(all_cmd.arg, cache->arg, sizeof(all_cmd.arg));
+        all_cmd.arg[x6200_sple_atue_trx] &= ~X6200_TRX_PROCESS_BITS;
+    }
+
+    t = now_ms();
+
     if (!send_regs(&all_cmd, sizeof(all_cmd))) {
         printf("Can't write data to BASE\n");
         return false;
     };
+    cache_commit_all();
+    x6200_control_state_load();
 
+    stats->push_ms = now_ms() - t;
+    stats->total_ms = now_ms() - start;
+
+    fprintf(stderr, "BASE init %.1f ms: open %.1f, ready %.1f (%u polls), info %.1f, calibration %.1f, "
+                    "host cmd %.1f, push %.1f%s\n",
+            stats->total_ms, stats->open_ms, stats->ready_ms, stats->ready_polls,
+            stats->base_info_ms, stats->calibration_ms, stats->host_cmd_ms,
+            stats->push_ms, stats->warm ? " (warm)" : "");
 
     return true;
 }
 
+bool x6200_control_init_timeout(uint32_t timeout_ms)
+{
+    x6200_control_init_stats_t stats = { 0 };
+
+    /* Re-init opens the bus again */
+
+    if (i2c) {
+        i2c_close();
+    }
+
+    bool ok = init_run(timeout_ms, &stats);
+
+    if (!ok && i2c) {
+        i2c_close();
+    }
+
+    pthread_mutex_lock(&init_mutex);
+    init_stats = stats;
+    pthread_mutex_unlock(&init_mutex);
+
+    return ok;
+}
+
 bool x6200_control_host_cmd(uint16_t data)
 {
     uint16_t command[2];
@@ -452,9 +1027,82 @@ bool x6200_control_cmd(x6200_cmd_enum_t cmd, uint32_t arg)
     command.addr = (addr & 0xFF) << 8 | (addr >> 8);
     command.arg = arg;
 
-    return send_regs(&command, sizeof(command));
+    if (!send_regs(&command, sizeof(command))) {
+        return false;
+    }
+    cache_commit(cmd, arg);
+    return true;
+}
+
+void x6200_control_mirror_set(x6200_cmd_enum_t cmd, uint32_t arg)
+{
+    all_cmd.arg[cmd] = arg;
+    cache_commit(cmd, arg);
 }
 
+bool x6200_control_cmd_batch(const x6200_cmd_arg_t *cmds, size_t count)
+{
+    struct i2c_msg   messages[I2C_RDWR_IOCTL_MAX_MSGS];
+    uint8_t          data[I2C_RDWR_IOCTL_MAX_MSGS * sizeof(cmd_struct_t)];
+    uint32_t         nmsgs = 0;
+    size_t           used = 0;
+    x6200_cmd_enum_t last_cmd = x6200_vfoa_ham_band;
+
+    if (!i2c) {
+        printf("Can't write to i2c, not opened\n");
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        x6200_cmd_enum_t cmd = cmds[i].cmd;
+        uint32_t         arg = cmds[i].arg;
+
+        all_cmd.arg[cmd] = arg;
+
+        /* Continue previous message, if register follows it */
+
+        if (nmsgs > 0 && cmd == last_cmd + 1 && used + sizeof(arg) <= sizeof(data)) {
+            memcpy(data + used, &arg, sizeof(arg));
+            messages[nmsgs - 1].len += sizeof(arg);
+            used += sizeof(arg);
+            last_cmd = cmd;
+            continue;
+        }
+
+        if (nmsgs == I2C_RDWR_IOCTL_MAX_MSGS || used + sizeof(cmd_struct_t) > sizeof(data)) {
+            if (!transfer(messages, nmsgs)) {
+                perror("Can't write batch to i2c");
+                return false;
+            }
+            nmsgs = 0;
+            used = 0;
+        }
+
+        uint16_t addr = cmd * 4;
+
+        addr = (addr & 0xFF) << 8 | (addr >> 8);
+        memcpy(data + used, &addr, sizeof(addr));
+        memcpy(data + used + sizeof(addr), &arg, sizeof(arg));
+
+        messages[nmsgs].addr = i2c_addr;
+        messages[nmsgs].flags = 0;
+        messages[nmsgs].len = sizeof(cmd_struct_t);
+        messages[nmsgs].buf = data + used;
+
+        nmsgs++;
+        used += sizeof(cmd_struct_t);
+        last_cmd = cmd;
+    }
+
+    if (nmsgs > 0 && !transfer(messages, nmsgs)) {
+        perror("Can't write batch to i2c");
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        cache_commit(cmds[i].cmd, cmds[i].arg);
+    }
+    return true;
+}
 
 uint32_t x6200_control_get(x6200_cmd_enum_t cmd)
 {
@@ -463,16 +1111,85 @@ uint32_t x6200_control_get(x6200_cmd_enum_t cmd)
 
 char *x6200_control_get_fw_version()
 {
-    static char version[0x80] = "\0";
-    if (get_regs(0, version, 0x80))
-        return version;
-    else
-        return NULL;
+    static _Thread_local char version[sizeof(base_info)];
+
+    /* Copy per calling thread, so refresh can't change it while caller reads */
+
+    pthread_mutex_lock(&base_info_mutex);
+
+    bool valid = base_info_valid;
+
+    if (valid) {
+        memcpy(version, base_info, sizeof(version));
+    }
+    pthread_mutex_unlock(&base_info_mutex);
+
+    return valid ? version : NULL;
+}
+
+bool x6200_control_base_info_get(x6200_base_info_t *info)
+{
+    pthread_mutex_lock(&base_info_mutex);
+
+    bool valid = base_info_valid;
+
+    if (valid) {
+        *info = base_info_parsed;
+    }
+    pthread_mutex_unlock(&base_info_mutex);
+
+    return valid;
+}
+
+bool x6200_control_calibration_get(x6200_calibration_t *calibration)
+{
+    pthread_mutex_lock(&base_info_mutex);
+
+    bool valid = base_info_valid;
+
+    if (valid) {
+        memcpy(calibration->data, calibration_data, sizeof(calibration->data));
+    }
+    pthread_mutex_unlock(&base_info_mutex);
+
+    return valid;
+}
+
+bool x6200_control_base_info_refresh()
+{
+    char info[sizeof(base_info)];
+    char calibration[sizeof(calibration_data)];
+
+    if (!get_regs(0, info, sizeof(info))) {
+        printf("Can't read BASE info\n");
+        return false;
+    }
+    if (!get_regs(0x100, calibration, sizeof(calibration))) {
+        printf("Can't read BASE calibration data\n");
+        return false;
+    }
+
+    pthread_mutex_lock(&base_info_mutex);
+    memcpy(base_info, info, sizeof(base_info));
+    memcpy(calibration_data, calibration, sizeof(calibration_data));
+    parse_base_info();
+    cache_store_base();
+    pthread_mutex_unlock(&base_info_mutex);
+
+    return true;
 }
 
 void x6200_control_idle()
 {
-    if (!send_regs(&all_cmd, sizeof(all_cmd))) {
+    if (send_regs(&all_cmd, sizeof(all_cmd))) {
+        return;
+    }
+
+    pthread_mutex_lock(&bus_mutex);
+    bool open = bus_stats.breaker_open;
+    pthread_mutex_unlock(&bus_mutex);
+
+    if (!open) {
         i2c_close();
         usleep(1000);
         i2c_open();
@@ -480,60 +1197,62 @@ void x6200_control_idle()
     }
 }
 
-static uint8_t band_index(int freq)
-{
-    if (freq < 1800000) {
-        return 0;
-    } else if (freq <= 2000000) {
-        return 1;
-    } else if (freq < 3500000) {
-        return 2;
-    } else if (freq <= 4000000) {
-        return 3;
-    } else if (freq < 5330500) {
-        return 4;
-    } else if (freq <= 5405000) {
-        return 5;
-    } else if (freq < 7000000) {
-        return 6;
-    } else if (freq <= 7300000) {
-        return 7;
-    } else if (freq < 10100000) {
-        return 8;
-    } else if (freq <= 10150000) {
-        return 9;
-    } else if (freq < 14000000) {
-        return 10;
-    } else if (freq <= 14350000) {
-        return 11;
-    } else if (freq < 18068000) {
-        return 12;
-    } else if (freq <= 18168000) {
-        return 13;
-    } else if (freq < 21000000) {
-        return 14;
-    } else if (freq <= 21450000) {
-        return 15;
-    } else if (freq < 24890000) {
-        return 16;
-    } else if (freq <= 24990000) {
-        return 17;
-    } else if (freq < 28000000) {
-        return 18;
-    } else if (freq <= 29700000) {
-        return 19;
-    } else if (freq < 50000000) {
-        return 20;
-    } else if (freq <= 54000000) {
-        return 21;
-    } else {
-        return 22;
+void x6200_control_sync_addr_set(uint16_t addr)
+{
+    sync_addr = addr;
+}
+
+bool x6200_control_sync(bool repair, x6200_control_sync_t *result)
+{
+    uint32_t            regs[x6200_last + 1];
+    x6200_cmd_arg_t     cmds[x6200_last + 1];
+    x6200_control_sync_t res = { 0 };
+    double              start = now_ms();
+
+    if (sync_addr == 0) {
+        errno = ENOTSUP;
+        return false;
+    }
+    if (!get_regs(sync_addr, regs, sizeof(regs))) {
+        return false;
+    }
+    res.read_us = (now_ms() - start) * 1000.0;
+
+    for (int i = 0; i <= x6200_last; i++) {
+        uint32_t mirror = all_cmd.arg[i];
+        uint32_t device = regs[i];
+
+        if (i == x6200_sple_atue_trx) {
+            mirror &= ~X6200_TRX_PROCESS_BITS;
+            device &= ~X6200_TRX_PROCESS_BITS;
+        }
+        if (mirror != device) {
+            cmds[res.mismatches].cmd = i;
+            cmds[res.mismatches].arg = all_cmd.arg[i];
+            res.mismatch_mask |= 1ull << i;
+            res.mismatches++;
+        }
+    }
+
+    bool ok = true;
+
+    if (repair && res.mismatches) {
+        ok = x6200_control_cmd_batch(cmds, res.mismatches);
+
+        if (ok) {
+            res.repaired = res.mismatches;
+        }
+    }
+
+    if (result) {
+        *result = res;
     }
+    return ok;
 }
 
 bool x6200_control_set_band(uint32_t freq)
 {
-    uint8_t band = band_index(freq);
+    uint8_t band = x6200_control_band_index(freq);
 
     if (band != cur_band)
     {
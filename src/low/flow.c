@@ -9,6 +9,8 @@
 
 #define _GNU_SOURCE
 #include "aether_radio/x6200_control/low/flow.h"
+#include "aether_radio/x6200_control/low/control.h"
+#include "aether_radio/x6200_control/low/transport.h"
 
 #include <fcntl.h>
 #include <stdio.h>
@@ -16,11 +18,12 @@
 #include <stddef.h>
 #include <string.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
 #define BUF_SIZE (sizeof(x6200_flow_t) * 3)
 
-static int flow_fd;
+static int flow_fd = -1;
 
 static uint8_t *buf = NULL;
 static uint8_t *buf_write = NULL;
@@ -29,6 +32,13 @@ static uint32_t prev_hkey = 0;
 
 static const uint32_t magic = 0xAA5555AA;
 
+static bool                         resync_on = false;
+static uint16_t                     resync_debounce_ms;
+static bool                         resync_prev = false;
+static double                       resync_rise;
+static double                       resync_replay_time;
+static x6200_flow_resync_stats_t    resync_stats;
+
 static uint32_t crctab[256] = {
     0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9,
     0x130476dc, 0x17c56b6b, 0x1a864db2, 0x1e475005,
@@ -109,15 +119,18 @@ uint32_t calc_crc32(const uint32_t *data, uint16_t len)
 
     return crc;
 }
-static bool open_flow_fd() {
-    flow_fd = open("/dev/ttyS1", O_RDWR | O_NONBLOCK| O_NOCTTY);
+/* Kernel backend */
 
-    if (flow_fd < 0)
-        return false;
+static int kernel_flow_open() {
+    const char  *dev = getenv("X6200_FLOW_DEV");
+    int         fd = open(dev ? dev : "/dev/ttyS1", O_RDWR | O_NONBLOCK| O_NOCTTY);
+
+    if (fd < 0)
+        return -1;
 
     struct termios attr;
 
-    tcgetattr(flow_fd, &attr);
+    tcgetattr(fd, &attr);
 
     cfsetispeed(&attr, B1152000);
     cfsetospeed(&attr, B1152000);
@@ -131,12 +144,38 @@ static bool open_flow_fd() {
     attr.c_lflag = attr.c_lflag & 0xffff7fb4;
 #endif
 
-    if (tcsetattr(flow_fd, 0, &attr) < 0)
+    if (tcsetattr(fd, 0, &attr) < 0)
     {
-        close(flow_fd);
-        return false;
+        close(fd);
+        return -1;
     }
-    return true;
+    return fd;
+}
+
+static void kernel_flow_close(int fd) {
+    close(fd);
+}
+
+static ssize_t kernel_flow_read(int fd, void *data, size_t len) {
+    return read(fd, data, len);
+}
+
+static void kernel_flow_flush(int fd) {
+    tcflush(fd, TCIFLUSH);
+}
+
+const x6200_flow_transport_t x6200_flow_kernel = {
+    .name = "kernel",
+    .open = kernel_flow_open,
+    .close = kernel_flow_close,
+    .read = kernel_flow_read,
+    .flush = kernel_flow_flush,
+};
+
+static bool open_flow_fd() {
+    flow_fd = x6200_transport_flow()->open();
+
+    return flow_fd >= 0;
 }
 
 bool x6200_flow_init()
@@ -151,7 +190,7 @@ bool x6200_flow_init()
 }
 
 AETHER_X6200CTRL_API bool x6200_flow_restart() {
-    close(flow_fd);
+    x6200_transport_flow()->close(flow_fd);
     buf_write = buf;
 
     usleep(10000);
@@ -159,6 +198,17 @@ AETHER_X6200CTRL_API bool x6200_flow_restart() {
     return open_flow_fd();
 }
 
+void x6200_flow_close()
+{
+    if (flow_fd >= 0) {
+        x6200_transport_flow()->close(flow_fd);
+        flow_fd = -1;
+    }
+    free(buf);
+    buf = NULL;
+    buf_write = NULL;
+}
+
 static bool flow_check(x6200_flow_t *pack)
 {
     uint32_t crc;
@@ -220,6 +270,56 @@ static bool flow_check(x6200_flow_t *pack)
     return result;
 }
 
+static double now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void resync_check(const x6200_flow_t *pack)
+{
+    bool    resync = pack->flag.resync;
+    double  now;
+
+    if (resync == resync_prev) {
+        return;
+    }
+    resync_prev = resync;
+    now = now_ms();
+
+    if (!resync) {
+        resync_stats.last_recovery_ms = now - resync_rise;
+
+        if (resync_stats.last_recovery_ms > resync_stats.max_recovery_ms) {
+            resync_stats.max_recovery_ms = resync_stats.last_recovery_ms;
+        }
+        return;
+    }
+    resync_rise = now;
+
+    if (resync_stats.replays > 0 && now - resync_replay_time < resync_debounce_ms) {
+        resync_stats.suppressed++;
+        return;
+    }
+    resync_replay_time = now;
+    resync_stats.replays++;
+    x6200_control_idle();
+}
+
+void x6200_flow_resync_replay(bool on, uint16_t debounce_ms)
+{
+    resync_on = on;
+    resync_debounce_ms = debounce_ms;
+    resync_prev = false;
+}
+
+void x6200_flow_resync_stats(x6200_flow_resync_stats_t *stats)
+{
+    *stats = resync_stats;
+}
+
 bool x6200_flow_read(x6200_flow_t *pack)
 {
     size_t buf_space = buf + BUF_SIZE - buf_write;
@@ -230,15 +330,32 @@ bool x6200_flow_read(x6200_flow_t *pack)
         buf_write -= shift;
     }
 
-    int res = read(flow_fd, buf_write, sizeof(x6200_flow_t));
+    int res = x6200_transport_flow()->read(flow_fd, buf_write, sizeof(x6200_flow_t));
 
     if (res > 0) {
         buf_write += res;
 
         if ((buf_write - buf) > sizeof(x6200_flow_t)) {
-            return flow_check(pack);
+            if (!flow_check(pack)) {
+                return false;
+            }
+            if (resync_on) {
+                resync_check(pack);
+            }
+            return true;
         }
     }
 
     return false;
 }
+
+int x6200_flow_fd()
+{
+    return flow_fd;
+}
+
+void x6200_flow_discard()
+{
+    x6200_transport_flow()->flush(flow_fd);
+    buf_write = buf;
+}
@@ -8,8 +8,10 @@
  */
 
 #include "aether_radio/x6200_control/low/gpio.h"
+#include "aether_radio/x6200_control/low/transport.h"
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,14 +26,67 @@
 #define X6200_PIN_BB_RESET 204
 
 
-static struct gpiod_chip *chip0;
-static struct gpiod_chip *chip1;
-static struct gpiod_line *line_morse_key;
-static struct gpiod_line *line_bb_reset;
-static struct gpiod_line *line_usb;
-static struct gpiod_line *line_light;
-static struct gpiod_line *line_wifi;
+/*
+ * Lines are requested in bulk groups, one consumer name per group. Lines of a group change with
+ * a single kernel call. Morse key is alone, so keying never waits for the other lines.
+ */
+
+typedef enum {
+    GROUP_MORSE_KEY = 0,
+    GROUP_POWER,            /* BB reset, USB, light */
+    GROUP_WIFI,
+
+    GROUP_LAST
+} group_id_t;
+
+#define GROUP_MAX_LINES 3
+
+typedef struct {
+    const char              *consumer;
+    bool                    chip1;
+    struct gpiod_line_bulk  bulk;
+    int                     values[GROUP_MAX_LINES];
+    unsigned int            count;
+} group_t;
+
+typedef struct {
+    int         pin;
+    int         offset;
+    int         initial;
+    group_id_t  group;
+} line_t;
 
+static group_t groups[GROUP_LAST] = {
+    [GROUP_MORSE_KEY]   = { "X6200_morse_key",          true },
+    [GROUP_POWER]       = { "X6200_bb_reset_usb_light", true },
+    [GROUP_WIFI]        = { "X6200_wifi",               false },
+};
+
+static const line_t lines[X6200_GPIO_LAST] = {
+    [X6200_GPIO_MORSE_KEY]  = { X6200_PIN_MORSE_KEY,    X6200_PIN_MORSE_KEY,    1,  GROUP_MORSE_KEY },
+    [X6200_GPIO_BB_RESET]   = { X6200_PIN_BB_RESET,     X6200_PIN_BB_RESET,     0,  GROUP_POWER },
+    [X6200_GPIO_USB]        = { X6200_PIN_USB,          X6200_PIN_USB,          0,  GROUP_POWER },
+    [X6200_GPIO_LIGHT]      = { X6200_PIN_LIGHT,        X6200_PIN_LIGHT,        0,  GROUP_POWER },
+    [X6200_GPIO_WIFI]       = { X6200_PIN_WIFI,         5,                      0,  GROUP_WIFI },
+};
+
+/* Position of line in its group, filled on init */
+
+static unsigned int line_index[X6200_GPIO_LAST];
+
+/* Pin to line + 1, 0 - unknown pin */
+
+static const uint8_t pin_lines[X6200_PIN_WIFI + 1] = {
+    [X6200_PIN_MORSE_KEY]   = X6200_GPIO_MORSE_KEY + 1,
+    [X6200_PIN_BB_RESET]    = X6200_GPIO_BB_RESET + 1,
+    [X6200_PIN_USB]         = X6200_GPIO_USB + 1,
+    [X6200_PIN_LIGHT]       = X6200_GPIO_LIGHT + 1,
+    [X6200_PIN_WIFI]        = X6200_GPIO_WIFI + 1,
+};
+
+static struct gpiod_chip        *chip0;
+static struct gpiod_chip        *chip1;
+static pthread_mutex_t          lines_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 int x6200_pin_wifi = X6200_PIN_WIFI;
 int x6200_pin_usb = X6200_PIN_USB;
@@ -48,52 +103,123 @@ static bool gpio_chip_open(const char * name, struct gpiod_chip **chip) {
     return true;
 }
 
-static bool gpio_line_open(unsigned int pin, const char * consumer, struct gpiod_chip *chip, int val, struct gpiod_line **line) {
-    *line = gpiod_chip_get_line(chip, pin);
-    if (*line == NULL) {
+static bool gpio_group_open(group_t *group, group_id_t id) {
+    unsigned int offsets[GROUP_MAX_LINES];
+
+    group->count = 0;
+
+    for (int i = 0; i < X6200_GPIO_LAST; i++) {
+        if (lines[i].group == id) {
+            line_index[i] = group->count;
+            offsets[group->count] = lines[i].offset;
+            group->values[group->count] = lines[i].initial;
+            group->count++;
+        }
+    }
+    if (gpiod_chip_get_lines(group->chip1 ? chip1 : chip0, offsets, group->count, &group->bulk) != 0) {
         return false;
     }
-    if (gpiod_line_request_output(*line, consumer, val) != 0) {
+    if (gpiod_line_request_bulk_output(&group->bulk, group->consumer, group->values) != 0) {
         return false;
     }
     return true;
 }
 
-bool x6200_gpio_init()
+static int pin_line(int pin)
+{
+    if (pin < 0 || pin > X6200_PIN_WIFI) {
+        return -1;
+    }
+    return pin_lines[pin] - 1;
+}
+
+/* Kernel backend */
+
+static bool kernel_gpio_init()
 {
-    EXIT_ON_FALSE(gpio_chip_open("gpiochip0", &chip0), "Can't open gpio chip 0");
-    EXIT_ON_FALSE(gpio_chip_open("gpiochip1", &chip1), "Can't open gpio chip 1");
-
-    EXIT_ON_FALSE(gpio_line_open(X6200_PIN_MORSE_KEY, "X6200_morse_key", chip1, 1, &line_morse_key), "Can't open GPIO morse line");
-    EXIT_ON_FALSE(gpio_line_open(X6200_PIN_BB_RESET, "X6200_bb_reset", chip1, 0, &line_bb_reset), "Can't open GPIO bb reset line");
-    EXIT_ON_FALSE(gpio_line_open(X6200_PIN_USB, "X6200_usb", chip1, 0, &line_usb), "Can't open GPIO usb line");
-    EXIT_ON_FALSE(gpio_line_open(X6200_PIN_LIGHT, "X6200_light", chip1, 0, &line_light), "Can't open GPIO light line");
-    EXIT_ON_FALSE(gpio_line_open(5, "X6200_wifi", chip0, 0, &line_wifi), "Can't open GPIO wifi line");
+    const char *name0 = getenv("X6200_GPIO_CHIP0");
+    const char *name1 = getenv("X6200_GPIO_CHIP1");
+
+    EXIT_ON_FALSE(gpio_chip_open(name0 ? name0 : "gpiochip0", &chip0), "Can't open gpio chip 0");
+    EXIT_ON_FALSE(gpio_chip_open(name1 ? name1 : "gpiochip1", &chip1), "Can't open gpio chip 1");
+
+    for (int i = 0; i < GROUP_LAST; i++) {
+        if (!gpio_group_open(&groups[i], i)) {
+            fprintf(stderr, "Can't open GPIO lines %s\n", groups[i].consumer);
+            return false;
+        }
+    }
     return true;
 }
 
-void x6200_gpio_set(int pin, int value)
+static bool kernel_gpio_set_many(uint32_t mask, uint32_t values)
 {
-    switch (pin)
-    {
-    case X6200_PIN_MORSE_KEY:
-        gpiod_line_set_value(line_morse_key, value);
-        break;
-    case X6200_PIN_BB_RESET:
-        gpiod_line_set_value(line_bb_reset, value);
-        break;
-    case X6200_PIN_USB:
-        gpiod_line_set_value(line_usb, value);
-        break;
-    case X6200_PIN_LIGHT:
-        gpiod_line_set_value(line_light, value);
-        break;
-    case X6200_PIN_WIFI:
-        gpiod_line_set_value(line_wifi, value);
-        break;
-
-    default:
+    bool ok = true;
+    bool changed[GROUP_LAST] = { false };
+
+    pthread_mutex_lock(&lines_mutex);
+
+    for (int i = 0; i < X6200_GPIO_LAST; i++) {
+        if (mask & X6200_GPIO_BIT(i)) {
+            group_t *group = &groups[lines[i].group];
+
+            group->values[line_index[i]] = (values >> i) & 1;
+            changed[lines[i].group] = true;
+        }
+    }
+
+    for (int i = 0; i < GROUP_LAST; i++) {
+        if (changed[i]) {
+            ok &= gpiod_line_set_value_bulk(&groups[i].bulk, groups[i].values) == 0;
+        }
+    }
+
+    pthread_mutex_unlock(&lines_mutex);
+    return ok;
+}
+
+static bool kernel_gpio_set(int pin, int value)
+{
+    int line = pin_line(pin);
+
+    if (line < 0) {
         printf("Unknown pin: %i\n", pin);
-        break;
+        return false;
+    }
+    return kernel_gpio_set_many(X6200_GPIO_BIT(line), (value ? 1u : 0u) << line);
+}
+
+const x6200_gpio_transport_t x6200_gpio_kernel = {
+    .name = "kernel",
+    .init = kernel_gpio_init,
+    .set = kernel_gpio_set,
+    .set_many = kernel_gpio_set_many,
+};
+
+bool x6200_gpio_init()
+{
+    return x6200_transport_gpio()->init();
+}
+
+void x6200_gpio_set(int pin, int value)
+{
+    x6200_transport_gpio()->set(pin, value);
+}
+
+bool x6200_gpio_set_many(uint32_t mask, uint32_t values)
+{
+    const x6200_gpio_transport_t *transport = x6200_transport_gpio();
+
+    if (transport->set_many) {
+        return transport->set_many(mask, values);
+    }
+
+    bool ok = true;
+
+    for (int i = 0; i < X6200_GPIO_LAST; i++) {
+        if (mask & X6200_GPIO_BIT(i)) {
+            ok &= transport->set(lines[i].pin, (values >> i) & 1);
+        }
     }
+    return ok;
 }
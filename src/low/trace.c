@@ -0,0 +1,175 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#include "trace_internal.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Ring slots are guarded by sequence number: 0 while the slot is written, index + 1 when done.
+ * Reader takes a copy and checks sequence again, so no lock on either side.
+ */
+
+typedef struct
+{
+    atomic_uint         seq;
+    x6200_trace_entry_t entry;
+} slot_t;
+
+atomic_bool x6200_trace_on = false;
+
+static slot_t       ring[X6200_TRACE_ENTRIES];
+static atomic_uint  head = 0;
+static atomic_uint  first = 0;
+
+uint64_t x6200_trace_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void x6200_trace_record(uint64_t start_ns, const struct i2c_msg *messages, uint32_t nmsgs, bool ok, int err)
+{
+    uint64_t    now = x6200_trace_now();
+    unsigned    index = atomic_fetch_add_explicit(&head, 1, memory_order_relaxed);
+    slot_t      *slot = &ring[index % X6200_TRACE_ENTRIES];
+
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    x6200_trace_entry_t *e = &slot->entry;
+
+    e->timestamp_ns = start_ns;
+    e->duration_ns = now - start_ns;
+    e->nmsgs = nmsgs;
+    e->ok = ok;
+    e->err = err;
+    e->read = nmsgs >= 2 && (messages[1].flags & I2C_M_RD);
+    e->reg = messages[0].len >= 2 ? (messages[0].buf[0] << 8 | messages[0].buf[1]) : 0;
+
+    const uint8_t   *payload;
+    uint16_t        stored;
+
+    if (e->read) {
+        payload = messages[1].buf;
+        e->len = messages[1].len;
+    } else {
+        payload = messages[0].buf + 2;
+        e->len = 0;
+
+        for (uint32_t i = 0; i < nmsgs; i++) {
+            e->len += messages[i].len >= 2 ? messages[i].len - 2 : 0;
+        }
+    }
+
+    stored = e->read ? messages[1].len : (messages[0].len >= 2 ? messages[0].len - 2 : 0);
+
+    if (stored > X6200_TRACE_PAYLOAD) {
+        stored = X6200_TRACE_PAYLOAD;
+    }
+    memcpy(e->payload, payload, stored);
+    e->stored = stored;
+    memset(e->payload + stored, 0, X6200_TRACE_PAYLOAD - stored);
+
+    atomic_store_explicit(&slot->seq, index + 1, memory_order_release);
+}
+
+void x6200_trace_enable(bool on)
+{
+    atomic_store(&x6200_trace_on, on);
+}
+
+void x6200_trace_clear()
+{
+    atomic_store(&first, atomic_load(&head));
+}
+
+static size_t trace_walk(x6200_trace_cb_t cb, void *user, x6200_trace_entry_t *out, size_t max)
+{
+    unsigned    end = atomic_load_explicit(&head, memory_order_acquire);
+    unsigned    begin = atomic_load(&first);
+    size_t      count = 0;
+
+    if (end - begin > X6200_TRACE_ENTRIES) {
+        begin = end - X6200_TRACE_ENTRIES;
+    }
+
+    for (unsigned i = begin; i != end && count < max; i++) {
+        slot_t              *slot = &ring[i % X6200_TRACE_ENTRIES];
+        x6200_trace_entry_t copy;
+
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != i + 1) {
+            continue;
+        }
+        copy = slot->entry;
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != i + 1) {
+            continue;
+        }
+
+        if (out) {
+            out[count] = copy;
+        }
+        if (cb) {
+            cb(&copy, user);
+        }
+        count++;
+    }
+    return count;
+}
+
+size_t x6200_trace_read(x6200_trace_entry_t *entries, size_t max)
+{
+    return trace_walk(NULL, NULL, entries, max);
+}
+
+size_t x6200_trace_dump_cb(x6200_trace_cb_t cb, void *user)
+{
+    return trace_walk(cb, user, NULL, X6200_TRACE_ENTRIES);
+}
+
+static void dump_line(const x6200_trace_entry_t *e, void *user)
+{
+    FILE        *f = user;
+
+    fprintf(f, "%llu.%09llu %s reg=%04X len=%u msgs=%u time=%u ns %s",
+            (unsigned long long)(e->timestamp_ns / 1000000000ull),
+            (unsigned long long)(e->timestamp_ns % 1000000000ull),
+            e->read ? "R" : "W", e->reg, e->len, e->nmsgs, e->duration_ns,
+            e->ok ? "ok" : "fail");
+
+    if (!e->ok) {
+        fprintf(f, " (%s)", strerror(e->err));
+    }
+    fprintf(f, " :");
+
+    for (uint16_t i = 0; i < e->stored; i++) {
+        fprintf(f, " %02X", e->payload[i]);
+    }
+    fprintf(f, "\n");
+}
+
+bool x6200_trace_dump(const char *path)
+{
+    FILE *f = fopen(path, "w");
+
+    if (!f) {
+        perror("Can't open trace dump");
+        return false;
+    }
+    x6200_trace_dump_cb(dump_line, f);
+    fclose(f);
+
+    return true;
+}
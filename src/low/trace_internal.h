@@ -0,0 +1,28 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#pragma once
+
+#include "aether_radio/x6200_control/low/trace.h"
+
+#include <linux/i2c.h>
+#include <stdatomic.h>
+
+/* Library internal part of tracer */
+
+extern atomic_bool x6200_trace_on;
+
+static inline bool x6200_trace_active()
+{
+    return __builtin_expect(atomic_load_explicit(&x6200_trace_on, memory_order_relaxed), 0);
+}
+
+AETHER_X6200CTRL_NO_EXPORT uint64_t x6200_trace_now();
+AETHER_X6200CTRL_NO_EXPORT void x6200_trace_record(uint64_t start_ns, const struct i2c_msg *messages,
+                                                   uint32_t nmsgs, bool ok, int err);
@@ -0,0 +1,399 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#define _GNU_SOURCE
+#include "aether_radio/x6200_control/low/transport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define READY_REG   0x2000
+#define MAX_PINS    512
+
+static const x6200_i2c_transport_t  *i2c_transport = NULL;
+static const x6200_flow_transport_t *flow_transport = NULL;
+static const x6200_gpio_transport_t *gpio_transport = NULL;
+
+/*
+ * Register spaces, shared by mem and file backends. Writes land in the register space,
+ * reads are served from the info space: BASE info at 0, calibration at 0x100, ready flag.
+ * Read-back window from X6200_TRANSPORT_READBACK_ADDR returns the register space.
+ */
+
+static uint8_t  mem_regs[X6200_TRANSPORT_REGS_SIZE];
+static uint8_t  mem_info[X6200_TRANSPORT_REGS_SIZE] = { [READY_REG] = 1 };
+static uint8_t  *file_regs = NULL;
+
+static bool regs_transfer(uint8_t *regs, const uint8_t *info, struct i2c_msg *messages, uint32_t nmsgs)
+{
+    uint16_t addr = 0;
+
+    for (uint32_t i = 0; i < nmsgs; i++) {
+        struct i2c_msg *msg = &messages[i];
+
+        if (msg->flags & I2C_M_RD) {
+            if (addr + msg->len > X6200_TRANSPORT_REGS_SIZE) {
+                errno = EINVAL;
+                return false;
+            }
+            if (addr >= X6200_TRANSPORT_READBACK_ADDR) {
+                memcpy(msg->buf, regs + addr - X6200_TRANSPORT_READBACK_ADDR, msg->len);
+            } else {
+                memcpy(msg->buf, info + addr, msg->len);
+            }
+        } else {
+            if (msg->len < 2) {
+                errno = EINVAL;
+                return false;
+            }
+            addr = msg->buf[0] << 8 | msg->buf[1];
+
+            if (addr + msg->len - 2 > X6200_TRANSPORT_REGS_SIZE) {
+                errno = EINVAL;
+                return false;
+            }
+            memcpy(regs + addr, msg->buf + 2, msg->len - 2);
+        }
+    }
+    return true;
+}
+
+/* I2C mem */
+
+static bool mem_i2c_open()
+{
+    return true;
+}
+
+static void mem_i2c_close()
+{
+}
+
+static bool mem_i2c_transfer(struct i2c_msg *messages, uint32_t nmsgs)
+{
+    return regs_transfer(mem_regs, mem_info, messages, nmsgs);
+}
+
+const x6200_i2c_transport_t x6200_i2c_mem = {
+    .name = "mem",
+    .open = mem_i2c_open,
+    .close = mem_i2c_close,
+    .transfer = mem_i2c_transfer,
+};
+
+uint8_t *x6200_transport_mem_regs()
+{
+    return mem_regs;
+}
+
+uint8_t *x6200_transport_mem_info()
+{
+    return mem_info;
+}
+
+/* I2C file */
+
+static bool file_i2c_open()
+{
+    const char *path = getenv("X6200_I2C_FILE");
+
+    if (file_regs) {
+        return true;
+    }
+
+    int fd = open(path ? path : "/tmp/x6200_regs", O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    if (ftruncate(fd, X6200_TRANSPORT_FILE_SIZE) < 0) {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, X6200_TRANSPORT_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    file_regs = map;
+
+    /* Reset request, BASE simulator serving the file raises it again */
+
+    file_regs[X6200_TRANSPORT_REGS_SIZE + READY_REG] = 0;
+    return true;
+}
+
+static void file_i2c_close()
+{
+    if (file_regs) {
+        munmap(file_regs, X6200_TRANSPORT_FILE_SIZE);
+        file_regs = NULL;
+    }
+}
+
+static bool file_i2c_transfer(struct i2c_msg *messages, uint32_t nmsgs)
+{
+    if (!file_regs) {
+        errno = EBADF;
+        return false;
+    }
+    return regs_transfer(file_regs, file_regs + X6200_TRANSPORT_REGS_SIZE, messages, nmsgs);
+}
+
+const x6200_i2c_transport_t x6200_i2c_file = {
+    .name = "file",
+    .open = file_i2c_open,
+    .close = file_i2c_close,
+    .transfer = file_i2c_transfer,
+};
+
+/* Flow mem, pipe lives until process exit */
+
+static int mem_pipe[2] = { -1, -1 };
+
+static int mem_flow_open()
+{
+    if (mem_pipe[0] < 0 && pipe2(mem_pipe, O_NONBLOCK | O_CLOEXEC) < 0) {
+        return -1;
+    }
+    return mem_pipe[0];
+}
+
+static void mem_flow_close(int fd)
+{
+    (void)fd;
+}
+
+static ssize_t mem_flow_read(int fd, void *buf, size_t len)
+{
+    return read(fd, buf, len);
+}
+
+static void mem_flow_flush(int fd)
+{
+    uint8_t buf[256];
+
+    while (read(fd, buf, sizeof(buf)) > 0) {
+    }
+}
+
+const x6200_flow_transport_t x6200_flow_mem = {
+    .name = "mem",
+    .open = mem_flow_open,
+    .close = mem_flow_close,
+    .read = mem_flow_read,
+    .flush = mem_flow_flush,
+};
+
+bool x6200_transport_mem_flow_write(const void *data, size_t len)
+{
+    if (mem_flow_open() < 0) {
+        return false;
+    }
+    return write(mem_pipe[1], data, len) == (ssize_t)len;
+}
+
+/* Flow file */
+
+static int file_flow_open()
+{
+    const char *path = getenv("X6200_FLOW_FILE");
+
+    if (!path) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY);
+
+    if (fd >= 0 && isatty(fd)) {
+        struct termios attr;
+
+        tcgetattr(fd, &attr);
+        cfmakeraw(&attr);
+        tcsetattr(fd, 0, &attr);
+    }
+    return fd;
+}
+
+static void file_flow_close(int fd)
+{
+    close(fd);
+}
+
+static ssize_t file_flow_read(int fd, void *buf, size_t len)
+{
+    return read(fd, buf, len);
+}
+
+static void file_flow_flush(int fd)
+{
+    if (isatty(fd)) {
+        tcflush(fd, TCIFLUSH);
+    }
+}
+
+const x6200_flow_transport_t x6200_flow_file = {
+    .name = "file",
+    .open = file_flow_open,
+    .close = file_flow_close,
+    .read = file_flow_read,
+    .flush = file_flow_flush,
+};
+
+/* GPIO mem */
+
+static int mem_pins[MAX_PINS];
+
+static bool mem_gpio_init()
+{
+    return true;
+}
+
+static bool mem_gpio_set(int pin, int value)
+{
+    if (pin < 0 || pin >= MAX_PINS) {
+        return false;
+    }
+    mem_pins[pin] = value;
+    return true;
+}
+
+const x6200_gpio_transport_t x6200_gpio_mem = {
+    .name = "mem",
+    .init = mem_gpio_init,
+    .set = mem_gpio_set,
+};
+
+int x6200_transport_mem_gpio_get(int pin)
+{
+    if (pin < 0 || pin >= MAX_PINS) {
+        return -1;
+    }
+    return mem_pins[pin];
+}
+
+/* GPIO file */
+
+static FILE *gpio_log = NULL;
+
+static bool file_gpio_init()
+{
+    const char *path = getenv("X6200_GPIO_FILE");
+
+    if (gpio_log) {
+        return true;
+    }
+    gpio_log = path ? fopen(path, "a") : stderr;
+
+    if (gpio_log) {
+        setvbuf(gpio_log, NULL, _IOLBF, 0);
+    }
+    return gpio_log != NULL;
+}
+
+static bool file_gpio_set(int pin, int value)
+{
+    struct timespec ts;
+
+    if (!gpio_log) {
+        return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    fprintf(gpio_log, "%ld.%09ld gpio %d %d\n", (long)ts.tv_sec, ts.tv_nsec, pin, value);
+
+    return true;
+}
+
+const x6200_gpio_transport_t x6200_gpio_file = {
+    .name = "file",
+    .init = file_gpio_init,
+    .set = file_gpio_set,
+};
+
+/* Selection */
+
+bool x6200_transport_select(const char *name)
+{
+    if (strcmp(name, "kernel") == 0) {
+        i2c_transport = &x6200_i2c_kernel;
+        flow_transport = &x6200_flow_kernel;
+        gpio_transport = &x6200_gpio_kernel;
+    } else if (strcmp(name, "mem") == 0) {
+        i2c_transport = &x6200_i2c_mem;
+        flow_transport = &x6200_flow_mem;
+        gpio_transport = &x6200_gpio_mem;
+    } else if (strcmp(name, "file") == 0) {
+        i2c_transport = &x6200_i2c_file;
+        flow_transport = &x6200_flow_file;
+        gpio_transport = &x6200_gpio_file;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void select_default()
+{
+    const char *name = getenv("X6200_TRANSPORT");
+
+    if (!name || !x6200_transport_select(name)) {
+        x6200_transport_select("kernel");
+    }
+}
+
+void x6200_transport_i2c_set(const x6200_i2c_transport_t *transport)
+{
+    i2c_transport = transport;
+}
+
+void x6200_transport_flow_set(const x6200_flow_transport_t *transport)
+{
+    flow_transport = transport;
+}
+
+void x6200_transport_gpio_set(const x6200_gpio_transport_t *transport)
+{
+    gpio_transport = transport;
+}
+
+const x6200_i2c_transport_t *x6200_transport_i2c()
+{
+    if (!i2c_transport) {
+        select_default();
+    }
+    return i2c_transport;
+}
+
+const x6200_flow_transport_t *x6200_transport_flow()
+{
+    if (!flow_transport) {
+        select_default();
+    }
+    return flow_transport;
+}
+
+const x6200_gpio_transport_t *x6200_transport_gpio()
+{
+    if (!gpio_transport) {
+        select_default();
+    }
+    return gpio_transport;
+}
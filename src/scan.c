@@ -0,0 +1,207 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#include "aether_radio/x6200_control/scan.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RATE_ALPHA  0.1f
+
+static x6200_scan_config_t  conf;
+static uint32_t             *freqs = NULL;
+static size_t               count = 0;
+static size_t               cur = 0;
+
+static x6200_scan_state_t   state = X6200_SCAN_IDLE;
+static bool                 settled;
+static uint8_t              skip_left;
+static uint8_t              dwell_left;
+
+static double               sent_time;
+static double               found_time;
+static double               active_time;
+
+static x6200_scan_stats_t   stats;
+static float                channel_avg_ms;
+
+static double now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static uint32_t channel_freq(size_t i)
+{
+    if (freqs) {
+        return freqs[i];
+    }
+    return conf.start + i * conf.step;
+}
+
+static void retune()
+{
+    sent_time = now_ms();
+
+    x6200_control_vfo_freq_set(conf.vfo, channel_freq(cur));
+    x6200_flow_discard();
+
+    settled = false;
+    skip_left = conf.skip_packets;
+    dwell_left = conf.dwell_packets > 0 ? conf.dwell_packets : 1;
+    state = X6200_SCAN_SETTLING;
+}
+
+static void next_channel()
+{
+    cur = (cur + 1) % count;
+    retune();
+}
+
+static void channel_done(float channel_ms)
+{
+    stats.channels++;
+
+    if (channel_avg_ms == 0.0f) {
+        channel_avg_ms = channel_ms;
+    } else {
+        channel_avg_ms += (channel_ms - channel_avg_ms) * RATE_ALPHA;
+    }
+    stats.channels_per_sec = channel_avg_ms > 0.0f ? 1000.0f / channel_avg_ms : 0.0f;
+}
+
+static bool is_active(const x6200_flow_t *pack)
+{
+    if (conf.use_sql && !pack->flag.sql_mute) {
+        return true;
+    }
+    if (conf.dbm > 0 && pack->dbm >= conf.dbm) {
+        return true;
+    }
+    return false;
+}
+
+bool x6200_scan_start(const x6200_scan_config_t *c)
+{
+    x6200_scan_stop();
+
+    conf = *c;
+
+    if (conf.freqs) {
+        if (conf.freqs_count == 0) {
+            return false;
+        }
+        freqs = malloc(conf.freqs_count * sizeof(uint32_t));
+
+        if (!freqs) {
+            return false;
+        }
+        memcpy(freqs, conf.freqs, conf.freqs_count * sizeof(uint32_t));
+        count = conf.freqs_count;
+    } else {
+        if (conf.step == 0 || conf.stop < conf.start) {
+            return false;
+        }
+        count = (conf.stop - conf.start) / conf.step + 1;
+    }
+    conf.freqs = NULL;
+
+    memset(&stats, 0, sizeof(stats));
+    channel_avg_ms = 0.0f;
+    cur = 0;
+    retune();
+
+    return true;
+}
+
+void x6200_scan_stop()
+{
+    free(freqs);
+    freqs = NULL;
+    count = 0;
+    state = X6200_SCAN_IDLE;
+}
+
+void x6200_scan_resume()
+{
+    if (state == X6200_SCAN_ACTIVE) {
+        channel_done(found_time - sent_time);
+        next_channel();
+    }
+}
+
+x6200_scan_state_t x6200_scan_process(const x6200_flow_t *pack)
+{
+    double now = now_ms();
+
+    switch (state)
+    {
+    case X6200_SCAN_SETTLING:
+        if (!settled) {
+            settled = true;
+            stats.settle_ms = now - sent_time;
+
+            if (stats.settle_avg_ms == 0.0f) {
+                stats.settle_avg_ms = stats.settle_ms;
+            } else {
+                stats.settle_avg_ms += (stats.settle_ms - stats.settle_avg_ms) * RATE_ALPHA;
+            }
+        }
+        if (skip_left > 0) {
+            skip_left--;
+            break;
+        }
+        state = X6200_SCAN_LISTENING;
+        /* fall through */
+
+    case X6200_SCAN_LISTENING:
+        if (is_active(pack)) {
+            found_time = now;
+            active_time = now;
+            state = X6200_SCAN_ACTIVE;
+            break;
+        }
+        if (--dwell_left > 0) {
+            break;
+        }
+        channel_done(now - sent_time);
+        next_channel();
+        break;
+
+    case X6200_SCAN_ACTIVE:
+        if (is_active(pack)) {
+            active_time = now;
+        } else if (conf.hang_ms > 0 && now - active_time >= conf.hang_ms) {
+            channel_done(found_time - sent_time);
+            next_channel();
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return state;
+}
+
+uint32_t x6200_scan_freq()
+{
+    if (count == 0) {
+        return 0;
+    }
+    return channel_freq(cur);
+}
+
+void x6200_scan_stats(x6200_scan_stats_t *s)
+{
+    *s = stats;
+}
@@ -0,0 +1,277 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#define _GNU_SOURCE
+
+#include "aether_radio/x6200_control/stream.h"
+#include "aether_radio/x6200_control/control.h"
+
+#include <endian.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define PAYLOAD_MAX (X6200_STREAM_SAMPLES * sizeof(float))
+
+typedef struct {
+    x6200_stream_header_t   header;
+    uint8_t                 payload[PAYLOAD_MAX];
+} buf_t;
+
+static x6200_stream_config_t    conf;
+static int                      sock = -1;
+static uint32_t                 seq = 0;
+static x6200_codec_t            codec;
+
+static struct sockaddr_in       dests[X6200_STREAM_MAX_DESTS];
+static size_t                   dests_count = 0;
+
+static buf_t                    bufs[X6200_STREAM_MAX_BATCH];
+static struct iovec             iovs[X6200_STREAM_MAX_BATCH];
+static size_t                   bufs_count = 0;
+
+/* Buffer major: datagrams of buffer i are msgs[i * dests_count ...] */
+
+static struct mmsghdr           msgs[X6200_STREAM_MAX_BATCH * X6200_STREAM_MAX_DESTS];
+
+static x6200_stream_stats_t     stats;
+
+static void msgs_build()
+{
+    memset(msgs, 0, sizeof(msgs));
+
+    for (size_t b = 0; b < conf.batch; b++) {
+        for (size_t d = 0; d < dests_count; d++) {
+            struct msghdr *m = &msgs[b * dests_count + d].msg_hdr;
+
+            m->msg_name = &dests[d];
+            m->msg_namelen = sizeof(dests[d]);
+            m->msg_iov = &iovs[b];
+            m->msg_iovlen = 1;
+        }
+    }
+}
+
+static bool parse_dest(const char *host, uint16_t port, struct sockaddr_in *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+
+    if (inet_pton(AF_INET, host, &addr->sin_addr) != 1) {
+        printf("Stream: wrong address %s\n", host);
+        return false;
+    }
+    return true;
+}
+
+static size_t encode(const x6200_flow_t *pack, uint8_t *payload)
+{
+    float db[X6200_CODEC_BINS];
+
+    switch (conf.format) {
+        case X6200_STREAM_SPECTRUM:
+            x6200_codec_spectrum(pack, db);
+            return x6200_codec_encode(&codec, db, payload);
+
+        default:
+            for (size_t i = 0; i < X6200_STREAM_SAMPLES; i++) {
+                uint32_t v;
+
+                memcpy(&v, &pack->samples[i], sizeof(v));
+                v = htole32(v);
+                memcpy(payload + i * sizeof(v), &v, sizeof(v));
+            }
+            return PAYLOAD_MAX;
+    }
+}
+
+bool x6200_stream_init(const x6200_stream_config_t *c)
+{
+    x6200_stream_close();
+
+    conf = *c;
+
+    if (conf.batch == 0) {
+        conf.batch = 1;
+    }
+    if (conf.batch > X6200_STREAM_MAX_BATCH) {
+        conf.batch = X6200_STREAM_MAX_BATCH;
+    }
+
+    sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+    if (sock < 0) {
+        perror("Can't create stream socket");
+        return false;
+    }
+
+    int ttl = conf.ttl ? conf.ttl : 1;
+
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    if (conf.iface) {
+        struct in_addr iface;
+
+        if (inet_pton(AF_INET, conf.iface, &iface) != 1 ||
+            setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) < 0)
+        {
+            printf("Stream: wrong interface %s\n", conf.iface);
+            x6200_stream_close();
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < X6200_STREAM_MAX_BATCH; i++) {
+        iovs[i].iov_base = &bufs[i];
+    }
+
+    x6200_codec_init(&codec, &conf.codec);
+
+    dests_count = 0;
+    bufs_count = 0;
+    seq = 0;
+    memset(&stats, 0, sizeof(stats));
+    msgs_build();
+
+    return true;
+}
+
+void x6200_stream_close()
+{
+    if (sock < 0) {
+        return;
+    }
+    x6200_stream_flush();
+    close(sock);
+    sock = -1;
+}
+
+bool x6200_stream_dest_add(const char *host, uint16_t port)
+{
+    struct sockaddr_in addr;
+
+    if (dests_count == X6200_STREAM_MAX_DESTS || !parse_dest(host, port, &addr)) {
+        return false;
+    }
+    x6200_stream_flush();
+
+    dests[dests_count++] = addr;
+    msgs_build();
+
+    return true;
+}
+
+bool x6200_stream_dest_remove(const char *host, uint16_t port)
+{
+    struct sockaddr_in addr;
+
+    if (!parse_dest(host, port, &addr)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < dests_count; i++) {
+        if (dests[i].sin_addr.s_addr == addr.sin_addr.s_addr && dests[i].sin_port == addr.sin_port) {
+            x6200_stream_flush();
+
+            memmove(&dests[i], &dests[i + 1], (dests_count - i - 1) * sizeof(dests[0]));
+            dests_count--;
+            msgs_build();
+
+            return true;
+        }
+    }
+    return false;
+}
+
+bool x6200_stream_packet(const x6200_flow_t *pack)
+{
+    if (sock < 0) {
+        return false;
+    }
+
+    struct timespec         ts;
+    buf_t                   *buf = &bufs[bufs_count];
+    x6200_stream_header_t   *h = &buf->header;
+    x6200_vfo_t             vfo = (x6200_control_get(x6200_vi_vm) & 0xFF) ? X6200_VFO_B : X6200_VFO_A;
+    size_t                  len = encode(pack, buf->payload);
+    uint32_t                flags;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memcpy(&flags, &pack->flag, sizeof(flags));
+
+    h->magic = htole32(X6200_STREAM_MAGIC);
+    h->version = X6200_STREAM_VERSION;
+    h->format = conf.format;
+    h->payload_len = htole16(len);
+    h->seq = htole32(seq++);
+    h->timestamp_us = htole64((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+    h->freq = htole32(x6200_control_get(vfo == X6200_VFO_A ? x6200_vfoa_freq : x6200_vfob_freq));
+    h->mode = x6200_control_get(vfo == X6200_VFO_A ? x6200_vfoa_mode : x6200_vfob_mode);
+    h->vfo = vfo;
+    h->dbm = pack->dbm;
+    h->tx_power = pack->tx_power;
+    h->vswr = pack->vswr;
+    h->alc_level = pack->alc_level;
+    h->vext = pack->vext;
+    h->vbat = pack->vbat;
+    h->batcap = pack->batcap;
+    memset(h->reserved, 0, sizeof(h->reserved));
+    h->flags = htole32(flags);
+
+    iovs[bufs_count].iov_len = sizeof(*h) + len;
+
+    bufs_count++;
+    stats.packets++;
+
+    if (bufs_count < conf.batch) {
+        return true;
+    }
+    return x6200_stream_flush();
+}
+
+bool x6200_stream_flush()
+{
+    size_t total = bufs_count * dests_count;
+    size_t sent = 0;
+
+    if (sock < 0 || total == 0) {
+        bufs_count = 0;
+        return true;
+    }
+
+    while (sent < total) {
+        int res = sendmmsg(sock, &msgs[sent], total - sent, MSG_DONTWAIT);
+
+        stats.syscalls++;
+
+        if (res <= 0) {
+            break;
+        }
+        for (int i = 0; i < res; i++) {
+            stats.bytes += msgs[sent + i].msg_len;
+        }
+        sent += res;
+    }
+
+    stats.datagrams += sent;
+    stats.errors += total - sent;
+    bufs_count = 0;
+
+    return sent == total;
+}
+
+void x6200_stream_stats(x6200_stream_stats_t *s)
+{
+    *s = stats;
+}
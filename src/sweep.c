@@ -0,0 +1,239 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Aether Xiegu X6200 Control
+ *
+ *  Copyright (c) 2022 Belousov Oleg aka R1CBU
+ *  Copyright (c) 2022 Rui Oliveira aka CT7ALW
+ */
+
+#include "aether_radio/x6200_control/sweep.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BW_SWR  2.0f
+
+static x6200_sweep_config_t conf;
+static x6200_sweep_state_t  state = X6200_SWEEP_IDLE;
+
+static x6200_sweep_point_t  *points = NULL;
+static size_t               count = 0;
+static size_t               cur = 0;
+static uint32_t             orig_freq;
+
+static uint8_t              step_packets;
+static uint8_t              run;            /* Readings in a row within tolerance */
+static float                run_swr;
+static float                run_power;
+static float                last_swr;
+
+static double               start_time;
+static double               end_time;
+static uint32_t             tx_packets;
+
+static double now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void retune()
+{
+    x6200_control_vfo_freq_set(conf.vfo, points[cur].freq);
+    x6200_flow_discard();
+
+    step_packets = 0;
+    run = 0;
+    state = X6200_SWEEP_SETTLING;
+}
+
+static void finish(x6200_sweep_state_t res)
+{
+    x6200_control_swrscan_set(false);
+    x6200_control_vfo_freq_set(conf.vfo, orig_freq);
+
+    end_time = now_ms();
+    state = res;
+}
+
+static void point_done(float swr, float power)
+{
+    points[cur].swr = swr;
+    points[cur].power = power;
+    cur++;
+
+    if (conf.max_swr > 0.0f && swr > conf.max_swr) {
+        finish(X6200_SWEEP_FAILED);
+    } else if (cur == count) {
+        finish(X6200_SWEEP_DONE);
+    } else {
+        retune();
+    }
+}
+
+bool x6200_sweep_start(const x6200_sweep_config_t *c)
+{
+    x6200_sweep_abort();
+
+    if (c->step == 0 || c->stop < c->start || (c->stop - c->start) / c->step >= X6200_SWEEP_MAX_POINTS) {
+        return false;
+    }
+
+    x6200_vfo_t fg_vfo = (x6200_control_get(x6200_vi_vm) & 0xFF) ? X6200_VFO_B : X6200_VFO_A;
+
+    if (c->vfo != fg_vfo) {
+        return false;
+    }
+    conf = *c;
+
+    if (conf.tolerance <= 0.0f) {
+        conf.tolerance = 0.1f;
+    }
+    if (conf.settle_packets == 0) {
+        conf.settle_packets = 2;
+    }
+    if (conf.max_packets == 0) {
+        conf.max_packets = 8;
+    }
+    if (conf.max_packets < conf.settle_packets) {
+        conf.max_packets = conf.settle_packets;
+    }
+
+    free(points);
+    count = (conf.stop - conf.start) / conf.step + 1;
+    points = calloc(count, sizeof(x6200_sweep_point_t));
+
+    if (!points) {
+        count = 0;
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        points[i].freq = conf.start + i * conf.step;
+    }
+
+    orig_freq = x6200_control_get(conf.vfo == X6200_VFO_A ? x6200_vfoa_freq : x6200_vfob_freq);
+    cur = 0;
+    tx_packets = 0;
+    start_time = now_ms();
+
+    /* Frequency first, so the carrier never starts on the previous one */
+
+    retune();
+    x6200_control_swrscan_set(true);
+
+    return true;
+}
+
+void x6200_sweep_abort()
+{
+    if (state == X6200_SWEEP_SETTLING || state == X6200_SWEEP_MEASURING) {
+        finish(X6200_SWEEP_FAILED);
+    }
+}
+
+x6200_sweep_state_t x6200_sweep_process(const x6200_flow_t *pack)
+{
+    if (state != X6200_SWEEP_SETTLING && state != X6200_SWEEP_MEASURING) {
+        return state;
+    }
+
+    step_packets++;
+
+    if (!pack->flag.tx) {
+        if (step_packets > conf.max_packets * 2) {
+            finish(X6200_SWEEP_FAILED);
+        }
+        return state;
+    }
+    tx_packets++;
+
+    float swr = pack->vswr * 0.1f;
+    float power = pack->tx_power * 0.1f;
+
+    if (state == X6200_SWEEP_SETTLING || fabsf(swr - last_swr) > conf.tolerance) {
+        run = 0;
+        run_swr = 0.0f;
+        run_power = 0.0f;
+        state = X6200_SWEEP_MEASURING;
+    }
+
+    run++;
+    run_swr += swr;
+    run_power += power;
+    last_swr = swr;
+
+    if (run >= conf.settle_packets) {
+        point_done(run_swr / run, run_power / run);
+    } else if (step_packets >= conf.max_packets) {
+        point_done(swr, power);
+    }
+    return state;
+}
+
+static uint32_t edge(size_t in, size_t out)
+{
+    const x6200_sweep_point_t *a = &points[in];
+    const x6200_sweep_point_t *b = &points[out];
+
+    if (b->swr == a->swr) {
+        return a->freq;
+    }
+
+    float k = (BW_SWR - a->swr) / (b->swr - a->swr);
+
+    return a->freq + ((int64_t)b->freq - (int64_t)a->freq) * k;
+}
+
+bool x6200_sweep_result(x6200_sweep_result_t *res)
+{
+    memset(res, 0, sizeof(*res));
+
+    if (!points || cur == 0) {
+        return false;
+    }
+    res->points = points;
+    res->count = cur;
+    res->packets = tx_packets;
+    res->elapsed_ms = (state == X6200_SWEEP_DONE || state == X6200_SWEEP_FAILED ? end_time : now_ms()) - start_time;
+
+    for (size_t i = 1; i < cur; i++) {
+        if (points[i].swr < points[res->min_index].swr) {
+            res->min_index = i;
+        }
+    }
+
+    /* Middle of a flat minimum, vswr comes in 0.1 steps */
+
+    size_t flat = res->min_index;
+
+    while (flat + 1 < cur && points[flat + 1].swr == points[res->min_index].swr) {
+        flat++;
+    }
+    res->min_index = (res->min_index + flat) / 2;
+
+    if (points[res->min_index].swr > BW_SWR) {
+        return true;
+    }
+
+    size_t lo = res->min_index;
+    size_t hi = res->min_index;
+
+    while (lo > 0 && points[lo - 1].swr <= BW_SWR) {
+        lo--;
+    }
+    while (hi + 1 < cur && points[hi + 1].swr <= BW_SWR) {
+        hi++;
+    }
+
+    /* Edge outside of the sweep stays at the last point */
+
+    res->bw_low = lo > 0 ? edge(lo, lo - 1) : points[lo].freq;
+    res->bw_high = hi + 1 < cur ? edge(hi, hi + 1) : points[hi].freq;
+
+    return true;
+}